@@ -0,0 +1,61 @@
+#!/bin/sh
+# Compare the PDF size and conversion time of two dotprint builds.
+#
+# Usage: bench-examples.sh BEFORE AFTER [INPUT...] [-- DOTPRINT_OPTION...]
+#
+# BEFORE and AFTER are dotprint binaries, e.g. built from two commits. Each
+# input (example_input/*.prn by default) is converted RUNS times (default 5)
+# by both and a markdown table of the output size and the best time is
+# printed to stdout.
+set -e
+
+BEFORE=$1
+AFTER=$2
+shift 2
+
+INPUTS=
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    INPUTS="$INPUTS $1"
+    shift
+done
+[ "$1" = "--" ] && shift
+[ -z "$INPUTS" ] && INPUTS=$(ls "$(dirname "$0")"/example_input/*.prn)
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# best wall clock time of RUNS conversions, in seconds; the last output is left in $WORK/out.pdf
+measure() {
+    bin=$1
+    input=$2
+    shift 2
+    best=
+    for i in $(seq "${RUNS:-5}"); do
+        rm -f "$WORK/out.pdf"
+        start=$(date +%s.%N)
+        if ! "$bin" "$@" -o "$WORK/out.pdf" "$input" > /dev/null 2> "$WORK/err"; then
+            echo "$0: $bin failed on $input:" >&2
+            cat "$WORK/err" >&2
+            exit 1
+        fi
+        end=$(date +%s.%N)
+        if [ ! -s "$WORK/out.pdf" ]; then
+            echo "$0: $bin wrote no output for $input" >&2
+            exit 1
+        fi
+        best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+    done
+    echo "$best"
+}
+
+echo "| input | size before | size after | time before (s) | time after (s) |"
+echo "|-------|------------:|-----------:|----------------:|---------------:|"
+
+for input in $INPUTS; do
+    timeBefore=$(measure "$BEFORE" "$input" "$@")
+    sizeBefore=$(wc -c < "$WORK/out.pdf")
+    timeAfter=$(measure "$AFTER" "$input" "$@")
+    sizeAfter=$(wc -c < "$WORK/out.pdf")
+    printf '| %s | %d | %d | %.3f | %.3f |\n' "$(basename "$input")" "$sizeBefore" "$sizeAfter" \
+        "$timeBefore" "$timeAfter"
+done
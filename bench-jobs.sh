@@ -0,0 +1,45 @@
+#!/bin/sh
+# Measure how the batch throughput scales with --jobs.
+#
+# Usage: bench-jobs.sh DOTPRINT COPIES INPUT... [-- DOTPRINT_OPTION...]
+#
+# Each input is converted COPIES times per run (so there is enough work for
+# all jobs), once for each job count in $JOBS (default "1 2 4 8 16 32"). A
+# markdown table of the total throughput and the speedup over one job is
+# printed to stdout.
+set -e
+
+DOTPRINT=$1
+COPIES=$2
+shift 2
+
+INPUTS=
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    INPUTS="$INPUTS $1"
+    shift
+done
+[ "$1" = "--" ] && shift
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+mkdir "$WORK/in" "$WORK/out"
+
+# inputs must have different names, otherwise they'd share an output file
+for input in $INPUTS; do
+    for i in $(seq "$COPIES"); do
+        cp "$input" "$WORK/in/$i-$(basename "$input")"
+    done
+done
+
+echo "| jobs | seconds | bytes/s | speedup |"
+echo "|-----:|--------:|--------:|--------:|"
+
+BASE=
+for jobs in ${JOBS:-1 2 4 8 16 32}; do
+    # the last line of --stats is the total: "total (...): N bytes in S s (B bytes/s), ..."
+    total=$("$DOTPRINT" --quiet --stats --jobs "$jobs" "$@" -o "$WORK/out" "$WORK"/in/* 2>&1 | tail -n 1)
+    seconds=$(echo "$total" | sed 's/.* bytes in \([0-9.]*\) s.*/\1/')
+    rate=$(echo "$total" | sed 's/.*(\([0-9]*\) bytes\/s).*/\1/')
+    [ -z "$BASE" ] && BASE=$rate
+    echo "| $jobs | $seconds | $rate | $(echo "$rate $BASE" | awk '{ printf "%.2f", $1 / $2 }') |"
+done
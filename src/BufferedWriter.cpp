@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BufferedWriter.h"
+
+#include <system_error>
+#include <cerrno>
+
+#include <unistd.h>
+
+BufferedWriter::BufferedWriter(int fd):
+    m_fd(fd),
+    m_error(0)
+{
+    m_buffer.reserve(BUFFER_SIZE);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    if (m_error == 0 && !m_buffer.empty())
+    {
+        writeOut(m_buffer.data(), m_buffer.size());
+    }
+}
+
+Cairo::ErrorStatus BufferedWriter::write(const unsigned char *data, unsigned int length)
+{
+    if (m_error != 0)
+    {
+        return CAIRO_STATUS_WRITE_ERROR;
+    }
+
+    if (m_buffer.size() + length > BUFFER_SIZE)
+    {
+        if (!writeOut(m_buffer.data(), m_buffer.size()))
+        {
+            return CAIRO_STATUS_WRITE_ERROR;
+        }
+        m_buffer.clear();
+
+        if (length >= BUFFER_SIZE)
+        {
+            // no point in copying big blocks around
+            return writeOut(data, length) ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR;
+        }
+    }
+
+    m_buffer.insert(m_buffer.end(), data, data + length);
+    return CAIRO_STATUS_SUCCESS;
+}
+
+void BufferedWriter::flush()
+{
+    if (m_error == 0 && !m_buffer.empty())
+    {
+        writeOut(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    if (m_error != 0)
+    {
+        throw std::system_error(m_error, std::generic_category(), "can't write output");
+    }
+}
+
+bool BufferedWriter::writeOut(const uint8_t *data, size_t length)
+{
+    while (length > 0)
+    {
+        const ssize_t r = ::write(m_fd, data, length);
+        if (r == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            m_error = errno;
+            return false;
+        }
+
+        data += r;
+        length -= r;
+    }
+
+    return true;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUFFERED_WRITER_H_
+#define BUFFERED_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cairomm/cairomm.h>
+
+/**
+ * \brief Buffered writer for a file descriptor.
+ *
+ * Intended as the write function of a Cairo stream surface, e.g. to write
+ * the PDF to stdout. At most BUFFER_SIZE bytes are held in memory.
+ */
+class BufferedWriter
+{
+public:
+    explicit BufferedWriter(int fd);
+
+    /** \brief Flushes the buffer, ignoring any errors. Call flush() to see them. */
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    /**
+     * Append data to the buffer, writing the buffer out when it fills up.
+     *
+     * The signature matches Cairo::Surface::SlotWriteFunc.
+     */
+    Cairo::ErrorStatus write(const unsigned char *data, unsigned int length);
+
+    /**
+     * Write out all buffered data.
+     *
+     * Throws std::system_error if this or any previous write failed.
+     */
+    void flush();
+
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+private:
+    int m_fd;
+    std::vector<uint8_t> m_buffer;
+    int m_error;
+
+    bool writeOut(const uint8_t *data, size_t length);
+};
+
+#endif // BUFFERED_WRITER_H_
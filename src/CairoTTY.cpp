@@ -18,34 +18,102 @@
  */
 
 #include "CairoTTY.h"
+#include "Diagnostics.h"
 
-#include <iostream>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 
-CairoTTY::CairoTTY(Cairo::RefPtr<Cairo::PdfSurface> cs, const PageSize &p, const Margins &m, ICharPreprocessor *preprocessor,
-    std::unique_ptr<ICodepageTranslator> translator):
-    m_cairoSurface(std::move(cs)),
+namespace
+{
+    /**
+     * \brief Parse an unsigned decimal number with an optional fractional part.
+     *
+     * Unlike strtod(), this doesn't depend on the locale. On success, pos is
+     * moved past the number.
+     */
+    bool parseDecimal(const std::string &s, size_t &pos, double &value)
+    {
+        size_t i = pos;
+        double v = 0.0;
+        bool digits = false;
+
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits = true)
+            v = v * 10.0 + (s[i] - '0');
+
+        if (i < s.size() && s[i] == '.')
+        {
+            double scale = 0.1;
+            for (i++; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits = true, scale /= 10.0)
+                v += (s[i] - '0') * scale;
+        }
+
+        if (!digits)
+            return false;
+
+        pos = i;
+        value = v;
+        return true;
+    }
+}
+
+CellGrid CellGrid::parse(const std::string &spec, unsigned defaultLpi)
+{
+    size_t pos = 0;
+    double cpi;
+    double lpi = defaultLpi;
+
+    bool ok = parseDecimal(spec, pos, cpi);
+    if (ok && pos < spec.size() && spec[pos] == '/')
+    {
+        pos++;
+        ok = parseDecimal(spec, pos, lpi) && lpi == std::floor(lpi);
+    }
+
+    // the cell must be at least one grid unit wide
+    if (!ok || pos != spec.size() || !(cpi > 0.0) || cpi > UNITS_PER_INCH || !(lpi >= 1.0) || lpi > 1000.0)
+    {
+        throw std::runtime_error("wrong grid: " + spec);
+    }
+
+    return { static_cast<unsigned>(std::lround(UNITS_PER_INCH / cpi)), static_cast<unsigned>(lpi) };
+}
+
+CairoTTY::CairoTTY(const PageSize &p, const Margins &m, std::unique_ptr<ICharPreprocessor> preprocessor,
+    std::shared_ptr<ICodepageTranslator> translator, std::shared_ptr<FontCache> fontCache, IPageSink *sink):
     m_fontName("Courier New"),
     m_fontSize(10.0),
     m_fontWeight(FontWeight::Normal),
     m_fontSlant(FontSlant::Normal),
     m_needFontChange(true),
+    m_font(nullptr),
+    m_fontSelections(0),
     m_margins(m),
-    m_preprocessor(preprocessor),
-    m_cpTranslator(std::move(translator))
+    m_stretchX(1.0),
+    m_stretchY(1.0),
+    m_lineSpacing(0.0),
+    m_gridX(0),
+    m_gridRow(0),
+    m_gridWidth(0),
+    m_gridRows(0),
+    m_sink(sink),
+    m_page(0),
+    m_lineCount(0),
+    m_pageHasContent(false),
+    m_textRunOpen(false),
+    m_pendingSpaces(0),
+    m_preprocessor(std::move(preprocessor)),
+    m_cpTranslator(std::move(translator)),
+    m_fontCache(std::move(fontCache))
 {
-    m_context = Cairo::Context::create(m_cairoSurface);
-
+    resetFontVariants();
     setPageSize(p);
-    stretchFont(1.0, 1.0);
     setFont();
     home();
 }
 
 CairoTTY::~CairoTTY()
 {
-    m_context.clear();
-    m_cairoSurface->finish();
 }
 
 CairoTTY &CairoTTY::operator<<(unsigned char c)
@@ -58,53 +126,215 @@ CairoTTY &CairoTTY::operator<<(unsigned char c)
     return *this;
 }
 
-void CairoTTY::setPreprocessor(ICharPreprocessor *preprocessor)
+void CairoTTY::write(const uint8_t *data, size_t size)
 {
-    m_preprocessor = preprocessor;
+    if (m_preprocessor)
+    {
+        m_preprocessor->process(*this, data, size);
+    }
+    else
+    {
+        appendRun(reinterpret_cast<const char*>(data), size);
+    }
+}
+
+void CairoTTY::finish()
+{
+    if (m_pageHasContent || m_page == 0)
+    {
+        deliverPage();
+    }
+}
+
+CairoTTY::PageLayout CairoTTY::layoutPages(const uint8_t *data, size_t size)
+{
+    m_onlyPage = NO_PAGE;
+
+    PageLayout layout;
+
+    /*
+     * A page can start in the middle of processing an input byte (e.g. when
+     * a character wraps onto a new line that doesn't fit the page anymore).
+     * So the pages are not started from the exact place where they begin,
+     * but from the last checkpoint before that. renderPage() then skips
+     * what belongs to the previous page.
+     *
+     * The input is fed in blocks ending with a line feed, and a checkpoint
+     * is taken after each block that started a new line. This keeps the
+     * replayed part short without copying the preprocessor for each byte.
+     */
+    Snapshot checkpoint = takeSnapshot(0);
+    unsigned lineCount = m_lineCount;
+
+    layout.pageStarts.push_back(checkpoint);
+
+    for (size_t i = 0; i < size; )
+    {
+        const size_t blockSize = getLayoutBlockSize(data + i, size - i);
+        write(data + i, blockSize);
+        i += blockSize;
+
+        while (layout.pageStarts.size() <= m_page)
+        {
+            layout.pageStarts.push_back(checkpoint);
+        }
+
+        if (m_lineCount != lineCount)
+        {
+            lineCount = m_lineCount;
+            checkpoint = takeSnapshot(i);
+        }
+    }
+
+    layout.lastPageEmpty = !m_pageHasContent;
+
+    return layout;
 }
 
-void CairoTTY::setFont(const std::string &family, double size, Cairo::FontSlant slant, Cairo::FontWeight weight)
+void CairoTTY::renderPage(const uint8_t *data, size_t size, const Snapshot &start, unsigned page)
 {
-    if (size < 0.0)
+    restoreSnapshot(start);
+    m_onlyPage = page;
+
+    // layoutPages() has seen this input and reported its problems already
+    Diagnostics::Suppressor suppressor;
+
+    // the rest of the block after the page ends is not drawn
+    for (size_t i = start.offset; i < size && m_page <= page; )
+    {
+        const size_t blockSize = getLayoutBlockSize(data + i, size - i);
+        write(data + i, blockSize);
+        i += blockSize;
+    }
+
+    if (m_page == page)
     {
-        throw std::runtime_error("CairoTTY: Can't specify negative font size!");
+        // the input ended on this page
+        deliverPage();
     }
+}
 
-    m_context->select_font_face(family, slant, weight);
-    m_context->set_font_size(size);
+size_t CairoTTY::getLayoutBlockSize(const uint8_t *data, size_t size)
+{
+    size = std::min(size, LAYOUT_BLOCK_SIZE);
 
-    m_fontExtents.emplace();
-    m_context->get_font_extents(*m_fontExtents);
+    const void *lineFeed = memchr(data, '\n', size);
+    return lineFeed ? static_cast<const uint8_t*>(lineFeed) - data + 1 : size;
+}
+
+CairoTTY::Snapshot CairoTTY::takeSnapshot(size_t offset) const
+{
+    Snapshot snapshot;
+
+    snapshot.offset = offset;
+    snapshot.page = m_page;
+    snapshot.fontName = m_fontName;
+    snapshot.fontSize = m_fontSize;
+    snapshot.fontWeight = m_fontWeight;
+    snapshot.fontSlant = m_fontSlant;
+    snapshot.x = m_x;
+    snapshot.y = m_y;
+    snapshot.stretchX = m_stretchX;
+    snapshot.stretchY = m_stretchY;
+    snapshot.lineSpacing = m_lineSpacing;
+    snapshot.gridX = m_gridX;
+    snapshot.gridRow = m_gridRow;
+
+    if (m_preprocessor)
+        snapshot.preprocessor = m_preprocessor->clone();
+
+    return snapshot;
+}
+
+void CairoTTY::restoreSnapshot(const Snapshot &snapshot)
+{
+    m_page = snapshot.page;
+    m_fontName = snapshot.fontName;
+    m_fontSize = snapshot.fontSize;
+    m_fontWeight = snapshot.fontWeight;
+    m_fontSlant = snapshot.fontSlant;
+    m_stretchX = snapshot.stretchX;
+    m_stretchY = snapshot.stretchY;
+    m_needFontChange = true;
+    resetFontVariants();
+    setFont();
+
+    m_x = snapshot.x;
+    m_y = snapshot.y;
+    m_lineSpacing = snapshot.lineSpacing;
+    m_gridX = snapshot.gridX;
+    m_gridRow = snapshot.gridRow;
+    m_styleIndex.reset();
+    m_textRunOpen = false;
+
+    if (snapshot.preprocessor)
+        m_preprocessor = snapshot.preprocessor->clone();
+    else
+        m_preprocessor.reset();
+}
+
+bool CairoTTY::isDrawing() const
+{
+    return !m_onlyPage || *m_onlyPage == m_page;
+}
+
+uint32_t CairoTTY::getStyleIndex()
+{
+    if (!m_styleIndex)
+    {
+        m_styleIndex = m_pageList.addStyle({m_fontName, m_fontSize, m_fontWeight, m_fontSlant, m_stretchX, m_stretchY});
+    }
+
+    return *m_styleIndex;
+}
+
+void CairoTTY::deliverPage()
+{
+    if (m_sink && isDrawing())
+    {
+        m_sink->addPage(m_pageList);
+    }
+
+    m_pageList.clear();
+    m_styleIndex.reset();
+    m_textRunOpen = false;
+}
+
+void CairoTTY::setPreprocessor(std::unique_ptr<ICharPreprocessor> preprocessor)
+{
+    m_preprocessor = std::move(preprocessor);
 }
 
 void CairoTTY::setFont()
 {
     if (m_needFontChange)
     {
-        Cairo::FontWeight weight;
-        Cairo::FontSlant slant;
+        if (m_fontSize < 0.0)
+        {
+            throw std::runtime_error("CairoTTY: Can't specify negative font size!");
+        }
 
-        switch (m_fontWeight)
+        FontCache::Font *&variant = m_fontVariants[static_cast<size_t>(m_fontWeight)][static_cast<size_t>(m_fontSlant)];
+        if (!variant)
         {
-        case FontWeight::Bold:
-            weight = Cairo::FONT_WEIGHT_BOLD;
-            break;
-        default:
-            weight = Cairo::FONT_WEIGHT_NORMAL;
-            break;
+            variant = &m_fontCache->getFont(m_fontName, m_fontSize, m_fontSlant, m_fontWeight, m_stretchX, m_stretchY);
         }
 
-        switch (m_fontSlant)
+        if (variant != m_font)
         {
-        case FontSlant::Italic:
-            slant = Cairo::FONT_SLANT_ITALIC;
-            break;
-        default:
-            slant = Cairo::FONT_SLANT_NORMAL;
-            break;
+            m_font = variant;
+            m_fontSelections++;
         }
 
-        setFont(m_fontName, m_fontSize, slant, weight);
+        m_needFontChange = false;
+    }
+}
+
+void CairoTTY::resetFontVariants()
+{
+    for (auto &variants: m_fontVariants)
+    {
+        variants.fill(nullptr);
     }
 }
 
@@ -120,13 +350,60 @@ void CairoTTY::setPageSize(const PageSize &p)
     }
 
     m_pageSize = p;
-    m_cairoSurface->set_size(m_pageSize.width, m_pageSize.height);
+    updateGridSize();
+}
+
+void CairoTTY::setCellGrid(const CellGrid &grid)
+{
+    if (grid.cellWidth == 0 || grid.lpi == 0)
+    {
+        throw std::runtime_error("CairoTTY: cell width and LPI of the grid must be positive");
+    }
+
+    m_cellGrid = grid;
+    updateGridSize();
+}
+
+void CairoTTY::updateGridSize()
+{
+    if (m_cellGrid)
+    {
+        const double width = m_pageSize.width - m_margins.left - m_margins.right;
+        const double height = m_pageSize.height - m_margins.top - m_margins.bottom;
+
+        m_gridWidth = static_cast<unsigned>(std::max(width, 0.0) * GRID_UNITS_PER_INCH / POINTS_PER_INCH);
+        m_gridRows = static_cast<unsigned>(std::max(height, 0.0) * m_cellGrid->lpi / POINTS_PER_INCH);
+    }
+}
+
+unsigned CairoTTY::getCellWidth() const
+{
+    const long width = std::lround(m_cellGrid->cellWidth * m_stretchX);
+    return static_cast<unsigned>(std::max(width, 1L));
+}
+
+void CairoTTY::updateGridPosition()
+{
+    m_x = m_gridX * POINTS_PER_INCH / GRID_UNITS_PER_INCH;
+    m_y = (m_gridRow + 1) * POINTS_PER_INCH / m_cellGrid->lpi; // the baseline is at the bottom of the row
 }
 
 void CairoTTY::home()
 {
-    m_x = 0.0;
-    m_y = m_fontExtents->height * m_stretchY; // so that the top of the first line touches 0.0
+    m_textRunOpen = false;
+    setFont();
+
+    if (m_cellGrid)
+    {
+        m_gridX = 0;
+        m_gridRow = 0;
+        updateGridPosition();
+    }
+    else
+    {
+        m_x = 0.0;
+        m_y = m_font->extents.height; // so that the top of the first line touches 0.0
+    }
 }
 
 void CairoTTY::newLine()
@@ -137,15 +414,32 @@ void CairoTTY::newLine()
 
 void CairoTTY::carriageReturn()
 {
+    m_textRunOpen = false;
+    m_gridX = 0;
     m_x = 0.0;
 }
 
 void CairoTTY::lineFeed()
 {
-    m_y += m_fontExtents->height * m_stretchY;
+    m_textRunOpen = false;
+    m_lineCount++;
+
+    bool fits;
+    if (m_cellGrid)
+    {
+        m_gridRow++;
+        updateGridPosition();
+        fits = m_gridRow < m_gridRows;
+    }
+    else
+    {
+        setFont();
+        m_y += m_lineSpacing > 0.0 ? m_lineSpacing : m_font->extents.height;
+        fits = m_margins.top + m_y <= m_pageSize.height - m_margins.bottom;
+    }
 
     // check if we still fit on the page
-    if (m_margins.top + m_y > m_pageSize.height - m_margins.bottom)
+    if (!fits)
     {
         newPage(); // forced pagebreak
     }
@@ -153,7 +447,11 @@ void CairoTTY::lineFeed()
 
 void CairoTTY::newPage()
 {
-    m_context->show_page();
+    deliverPage();
+
+    m_page++;
+    m_lineCount++;
+    m_pageHasContent = false;
     home();
 }
 
@@ -161,74 +459,281 @@ void CairoTTY::setFontName(const std::string &family)
 {
     m_fontName = family;
     m_needFontChange = true;
+    resetFontVariants();
+    m_styleIndex.reset();
+    m_textRunOpen = false;
 }
 
 void CairoTTY::setFontSize(double size)
 {
     m_fontSize = size;
     m_needFontChange = true;
+    resetFontVariants();
+    m_styleIndex.reset();
+    m_textRunOpen = false;
 }
 
 void CairoTTY::setFontWeight(FontWeight weight)
 {
     m_fontWeight = weight;
     m_needFontChange = true;
+    m_styleIndex.reset();
+    m_textRunOpen = false;
 }
 
 void CairoTTY::setFontSlant(FontSlant slant)
 {
     m_fontSlant = slant;
     m_needFontChange = true;
+    m_styleIndex.reset();
+    m_textRunOpen = false;
 }
 
 void CairoTTY::stretchFont(double stretch_x, double stretch_y)
 {
+    if (stretch_x != m_stretchX || stretch_y != m_stretchY)
+    {
+        // the variants are only kept for the current stretch
+        resetFontVariants();
+    }
+
     m_stretchX = stretch_x;
     m_stretchY = stretch_y;
+    m_needFontChange = true;
+    m_styleIndex.reset();
+    m_textRunOpen = false;
+}
+
+void CairoTTY::setLineSpacing(double spacing)
+{
+    m_lineSpacing = spacing;
 }
 
 void CairoTTY::append(char c)
 {
     gunichar uc;
-    if (m_cpTranslator->translate(c, uc))
+    const char *utf8;
+    size_t utf8Length;
+    if (m_cpTranslator->translateUtf8(c, uc, utf8, utf8Length))
     {
-        append(uc);
+        append(uc, utf8, utf8Length);
     }
 }
 
-void CairoTTY::append(gunichar c)
+void CairoTTY::append(gunichar c, const char *utf8, size_t utf8Length)
 {
     if (c == 0x09)
     {
         // TODO: tab handling
         return;
     }
+    else if (c == ' ')
+    {
+        appendSpaces(1);
+        return;
+    }
     else if (Glib::Unicode::iscntrl(c))
     {
-        std::cout << "Cannot print character 0x" << std::hex << c << std::endl;
+        // control characters are all below 0x100
+        Diagnostics::report(DiagnosticSource::CairoTTY, static_cast<uint8_t>(c));
         return;
     }
 
     setFont();
 
-    Glib::ustring s(1, c);
+    double x_advance;
+    double cellWidth = 0.0;
+    unsigned gridAdvance = 0;
+    if (m_cellGrid)
+    {
+        gridAdvance = getCellWidth();
+        if (m_gridX + gridAdvance > m_gridWidth)
+        {
+            newLine(); // forced linebreak - text wraps to the next line
+        }
+
+        cellWidth = x_advance = gridAdvance * POINTS_PER_INCH / GRID_UNITS_PER_INCH;
+    }
+    else
+    {
+        // the stretch is part of the font, so is the advance
+        x_advance = m_font->getAdvance(c);
+
+        if (m_margins.left + m_x + x_advance > m_pageSize.width - m_margins.right)
+        {
+            newLine(); // forced linebreak - text wraps to the next line
+        }
+    }
+
+    if (isDrawing())
+    {
+        const double x = m_margins.left + m_x;
+        const double y = m_margins.top + m_y;
+
+        if (m_textRunOpen && m_pendingSpaces > 0)
+        {
+            if (m_pendingSpaces <= MAX_SPACES_IN_TEXT_RUN)
+            {
+                // just a few spaces between words, keep them in the run
+                for (size_t i = 0; i < m_pendingSpaces; i++)
+                    m_pageList.appendText(" ", 1);
+            }
+            else
+            {
+                m_textRunOpen = false;
+            }
+        }
+        m_pendingSpaces = 0;
+
+        if (m_textRunOpen)
+        {
+            // the character directly follows the previous one
+            m_pageList.appendText(utf8, utf8Length);
+        }
+        else
+        {
+            m_pageList.addText(x, y, getStyleIndex(), utf8, utf8Length, cellWidth);
+            m_textRunOpen = true;
+        }
+    }
+    m_pageHasContent = true;
+
+    if (m_cellGrid)
+    {
+        m_gridX += gridAdvance;
+        updateGridPosition();
+    }
+    else
+    {
+        // We ignore y_advance, as we in no way can support
+        // vertical text layout.
+        m_x += x_advance;
+    }
+}
+
+void CairoTTY::appendRun(const char *data, size_t size)
+{
+    const uint8_t *in = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t * const end = in + size;
+
+    // translate whole blocks, without a virtual call per byte
+    m_translated.resize(TRANSLATE_BLOCK_SIZE);
+    while (in != end)
+    {
+        const size_t blockSize = std::min<size_t>(end - in, TRANSLATE_BLOCK_SIZE);
+        const size_t count = m_cpTranslator->translateUtf8(in, blockSize, m_translated.data());
+        appendTranslated(m_translated.data(), count);
+        in += blockSize;
+    }
+}
+
+void CairoTTY::appendGraphics(const GraphicsBand &band)
+{
+    const double width = band.width * POINTS_PER_INCH / band.dpiX;
+
+    if (isDrawing() && band.width > 0 && band.height > 0)
+    {
+        double top;
+        if (m_cellGrid)
+        {
+            top = m_y - POINTS_PER_INCH / m_cellGrid->lpi;
+        }
+        else
+        {
+            setFont();
+            top = m_y - m_font->extents.ascent;
+        }
+
+        m_pageList.addBitmap(m_margins.left + m_x, m_margins.top + top, POINTS_PER_INCH / band.dpiX,
+            POINTS_PER_INCH / band.dpiY, band.width, band.height, band.rows, band.stride);
+    }
+    m_pageHasContent = true;
+
+    // text after the graphics starts a new run
+    m_textRunOpen = false;
+    m_pendingSpaces = 0;
+
+    if (m_cellGrid)
+    {
+        m_gridX += static_cast<unsigned>(std::lround(band.width * GRID_UNITS_PER_INCH / band.dpiX));
+        updateGridPosition();
+    }
+    else
+    {
+        m_x += width;
+    }
+}
 
-    Cairo::TextExtents t;
-    m_context->get_text_extents(s, t);
-    double x_advance = m_stretchX * t.x_advance;
+void CairoTTY::appendTranslated(const TranslatedChar *text, size_t size)
+{
+    const TranslatedChar * const end = text + size;
 
-    if (m_margins.left + m_x + x_advance > m_pageSize.width - m_margins.right)
+    while (text != end)
     {
-        newLine(); // forced linebreak - text wraps to the next line
+        if (text->c == ' ')
+        {
+            // a run of spaces is just a move
+            const TranslatedChar *runEnd = std::find_if(text, end, [](const TranslatedChar &t) { return t.c != ' '; });
+            appendSpaces(runEnd - text);
+            text = runEnd;
+        }
+        else
+        {
+            append(text->c, text->utf8, text->utf8Length);
+            ++text;
+        }
     }
+}
+
+void CairoTTY::appendSpaces(size_t count)
+{
+    setFont();
+
+    while (count > 0)
+    {
+        // how many spaces fit on the current line; at least one does after wrapping
+        size_t fitting;
+        double x_advance;
+        if (m_cellGrid)
+        {
+            const unsigned gridAdvance = getCellWidth();
+            if (m_gridX + gridAdvance > m_gridWidth)
+            {
+                newLine(); // forced linebreak - text wraps to the next line
+            }
+
+            fitting = std::clamp<size_t>((m_gridWidth - std::min(m_gridX, m_gridWidth)) / gridAdvance, 1, count);
+            x_advance = fitting * gridAdvance * POINTS_PER_INCH / GRID_UNITS_PER_INCH;
+        }
+        else
+        {
+            const double spaceAdvance = m_font->getAdvance(' ');
+            const double lineEnd = m_pageSize.width - m_margins.right;
+            if (m_margins.left + m_x + spaceAdvance > lineEnd)
+            {
+                newLine(); // forced linebreak - text wraps to the next line
+            }
+
+            const double room = spaceAdvance > 0.0 ?
+                std::floor((lineEnd - m_margins.left - m_x) / spaceAdvance) : count;
+            fitting = static_cast<size_t>(std::clamp(room, 1.0, static_cast<double>(count)));
+            x_advance = fitting * spaceAdvance;
+        }
 
-    m_context->save();
-    m_context->move_to(m_margins.left + m_x, m_margins.top + m_y);
-    m_context->scale(m_stretchX, m_stretchY);
-    m_context->show_text(s);
-    m_context->restore();
+        m_pageHasContent = true;
 
-    // We ignore y_advance, as we in no way can support
-    // vertical text layout.
-    m_x += x_advance;
+        // nothing is drawn, the spaces just move the position
+        m_pendingSpaces += fitting;
+        if (m_cellGrid)
+        {
+            m_gridX += static_cast<unsigned>(fitting) * getCellWidth();
+            updateGridPosition();
+        }
+        else
+        {
+            m_x += x_advance;
+        }
+
+        count -= fitting;
+    }
 }
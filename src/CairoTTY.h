@@ -24,11 +24,16 @@
 #include <memory>
 #include <string>
 #include <algorithm>
+#include <array>
 #include <optional>
+#include <vector>
 
 #include <glibmm.h>
 #include <cairomm/cairomm.h>
 
+#include "DisplayList.h"
+#include "FontCache.h"
+
 /** \brief Structure describing page margins. */
 struct Margins
 {
@@ -76,16 +81,56 @@ struct PageSize
     double height;
 };
 
-enum class FontWeight
+/**
+ * \brief Character cell grid of the fixed-pitch layout.
+ *
+ * See CairoTTY::setCellGrid().
+ */
+struct CellGrid
 {
-    Normal,
-    Bold
+    /** \brief Cell width of unstretched text, in units of 1/UNITS_PER_INCH inch. */
+    unsigned cellWidth;
+
+    /** \brief Lines per inch. */
+    unsigned lpi;
+
+    /**
+     * \brief Horizontal resolution of the grid.
+     *
+     * This is divisible by all the usual pitches (5, 8.5, 10, 12, 15, 17
+     * and 20 CPI).
+     */
+    static constexpr unsigned UNITS_PER_INCH = 1020;
+
+    /**
+     * \brief Parse a grid specification "CPI[/LPI]".
+     *
+     * CPI can have a fractional part (e.g. "8.5/6"). If LPI is missing,
+     * defaultLpi is used.
+     *
+     * \throw std::runtime_error if spec is not a valid grid.
+     */
+    static CellGrid parse(const std::string &spec, unsigned defaultLpi);
 };
 
-enum class FontSlant
+/**
+ * \brief A band of 1-bit graphics, as printed by one pass of the print head.
+ *
+ * The rows are stored top to bottom, stride bytes each, with the leftmost
+ * dot in the most significant bit. A set bit is a printed dot.
+ */
+struct GraphicsBand
 {
-    Normal,
-    Italic
+    /** \brief Size in dots. */
+    unsigned width;
+    unsigned height;
+
+    /** \brief Dots per inch. */
+    double dpiX;
+    double dpiY;
+
+    size_t stride;
+    const uint8_t *rows;
 };
 
 class ICairoTTYProtected
@@ -103,8 +148,30 @@ public:
     virtual void setFontSlant(FontSlant slant) = 0;
     virtual void stretchFont(double stretch_x, double stretch_y = 1.0) = 0;
 
+    /**
+     * Set the distance of the lines in points.
+     *
+     * Zero selects the line height of the font.
+     */
+    virtual void setLineSpacing(double spacing) = 0;
+
     virtual void append(char c) = 0;
 
+    /**
+     * Append a run of printable bytes.
+     *
+     * This is the same as calling append() for each byte, only faster.
+     */
+    virtual void appendRun(const char *data, size_t size) = 0;
+
+    /**
+     * Print graphics at the current position.
+     *
+     * The top of the band is at the top of the current line. The position
+     * then moves right by the width of the band.
+     */
+    virtual void appendGraphics(const GraphicsBand &band) = 0;
+
     virtual ~ICairoTTYProtected() = default;
 };
 
@@ -113,28 +180,165 @@ class ICharPreprocessor
 public:
     virtual void process(ICairoTTYProtected &ctty, uint8_t c) = 0;
 
+    /**
+     * Process a block of input.
+     *
+     * This is equivalent to processing the bytes one by one; in particular,
+     * escape sequences may be split between blocks. The default implementation
+     * does just that, preprocessors can pass runs of printable bytes to
+     * ICairoTTYProtected::appendRun() instead.
+     */
+    virtual void process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            process(ctty, data[i]);
+    }
+
+    /** \brief Create a copy of this preprocessor, including its parsing state. */
+    virtual std::unique_ptr<ICharPreprocessor> clone() const = 0;
+
     virtual ~ICharPreprocessor() = default;
 };
 
+/**
+ * \brief A character translated by ICodepageTranslator, with its UTF-8 encoding.
+ *
+ * utf8 points to utf8Length bytes that stay valid as long as the translator
+ * exists.
+ */
+struct TranslatedChar
+{
+    gunichar c;
+    const char *utf8;
+    size_t utf8Length;
+};
+
 class ICodepageTranslator
 {
 public:
     virtual bool translate(uint8_t in, gunichar &out) = 0;
 
+    /**
+     * Translate a byte, getting also the UTF-8 encoding of the result.
+     *
+     * The UTF-8 encoding is precomputed: utf8 points to utf8Length bytes that
+     * stay valid as long as the translator exists.
+     */
+    virtual bool translateUtf8(uint8_t in, gunichar &out, const char *&utf8, size_t &utf8Length) = 0;
+
+    /**
+     * Translate a block of bytes, getting also the UTF-8 encoding of each
+     * character.
+     *
+     * Bytes that can't be translated are dropped, just like when the single
+     * byte translateUtf8() returns false. The out buffer must have room for
+     * size characters. Returns the number of characters stored in out.
+     *
+     * The default implementation translates the bytes one by one.
+     */
+    virtual size_t translateUtf8(const uint8_t *in, size_t size, TranslatedChar *out)
+    {
+        TranslatedChar * const outStart = out;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            if (translateUtf8(in[i], out->c, out->utf8, out->utf8Length))
+                ++out;
+        }
+
+        return out - outStart;
+    }
+
     virtual ~ICodepageTranslator() = default;
 };
 
 class CairoTTY: protected ICairoTTYProtected
 {
 public:
-    CairoTTY(Cairo::RefPtr<Cairo::PdfSurface> cs, const PageSize &p, const Margins &m, ICharPreprocessor *preprocessor,
-        std::unique_ptr<ICodepageTranslator> translator);
+    /**
+     * \brief State of the TTY and its preprocessor at some input offset.
+     *
+     * Processing can be resumed from a snapshot, see renderPage().
+     */
+    struct Snapshot
+    {
+        size_t offset;
+        unsigned page;
+
+        std::string fontName;
+        double fontSize;
+        FontWeight fontWeight;
+        FontSlant fontSlant;
+        double x;
+        double y;
+        double stretchX;
+        double stretchY;
+        double lineSpacing;
+        unsigned gridX;
+        unsigned gridRow;
+
+        std::shared_ptr<const ICharPreprocessor> preprocessor;
+    };
+
+    /** \brief Result of layoutPages(). */
+    struct PageLayout
+    {
+        /** \brief For each page, a snapshot from which the page can be rendered. */
+        std::vector<Snapshot> pageStarts;
+
+        /** \brief True if nothing is printed on the last page. */
+        bool lastPageEmpty;
+    };
+
+    /**
+     * Create the TTY.
+     *
+     * CairoTTY only lays out the input. Finished pages are passed as display
+     * lists to the sink, which may be null if the pages are not needed.
+     */
+    CairoTTY(const PageSize &p, const Margins &m, std::unique_ptr<ICharPreprocessor> preprocessor,
+        std::shared_ptr<ICodepageTranslator> translator, std::shared_ptr<FontCache> fontCache, IPageSink *sink);
 
     virtual ~CairoTTY();
 
     CairoTTY &operator<<(uint8_t c);
 
-    void setPreprocessor(ICharPreprocessor *preprocessor);
+    /**
+     * Feed a block of input bytes to the TTY.
+     *
+     * This is equivalent to passing the bytes one by one via operator<<,
+     * but avoids the per-byte call overhead.
+     */
+    void write(const uint8_t *data, size_t size);
+
+    /**
+     * Pass the last page to the sink.
+     *
+     * Must be called at the end of the input. Like cairo does, an empty last
+     * page is dropped unless it's the only page.
+     */
+    void finish();
+
+    /**
+     * Process the whole input without drawing anything and find where the
+     * pages start.
+     *
+     * Form feeds as well as page breaks forced by overflowing the bottom
+     * margin are taken into account. The returned snapshots can be used to
+     * render each page independently by renderPage().
+     */
+    PageLayout layoutPages(const uint8_t *data, size_t size);
+
+    /**
+     * Render a single page of the input.
+     *
+     * Processing resumes from the snapshot start (as returned by layoutPages()
+     * for the page) but only the given page is passed to the sink. Problems
+     * in the input are not reported, layoutPages() has done that.
+     */
+    void renderPage(const uint8_t *data, size_t size, const Snapshot &start, unsigned page);
+
+    void setPreprocessor(std::unique_ptr<ICharPreprocessor> preprocessor);
 
     virtual void setFontName(const std::string &family) override;
     virtual void setFontSize(double size) override;
@@ -142,6 +346,25 @@ public:
     void setPageSize(const PageSize &p);
     virtual void home() override;
 
+    /**
+     * Switch to the fixed-pitch layout.
+     *
+     * Instead of advancing by the measured glyph widths, each character then
+     * takes one cell of the grid. The cell width is given by the grid,
+     * multiplied by the horizontal stretch (so condensed and expanded
+     * printing get narrower and wider cells). The row height is given by the
+     * LPI of the grid. Positions are kept as integers, so they don't drift.
+     *
+     * Call home() after changing the grid.
+     */
+    void setCellGrid(const CellGrid &grid);
+
+    /** \brief Number of times the current font was switched to a different one. */
+    unsigned getFontSelectionCount() const
+    {
+        return m_fontSelections;
+    }
+
 protected:
     virtual void newLine() override;
     virtual void carriageReturn() override;
@@ -152,18 +375,32 @@ protected:
     virtual void setFontSlant(FontSlant slant) override;
     virtual void stretchFont(double stretch_x, double stretch_y = 1.0) override;
 
+    /** \brief Only used without a cell grid, the grid has its own line spacing. */
+    virtual void setLineSpacing(double spacing) override;
+
     virtual void append(char c) override;
+    virtual void appendRun(const char *data, size_t size) override;
+    virtual void appendGraphics(const GraphicsBand &band) override;
 
 private:
-    Cairo::RefPtr<Cairo::PdfSurface> m_cairoSurface;
-    Cairo::RefPtr<Cairo::Context> m_context;
-
     std::string m_fontName;
     double m_fontSize;
     FontWeight m_fontWeight;
     FontSlant m_fontSlant;
     bool m_needFontChange;
-    std::optional<Cairo::FontExtents> m_fontExtents;
+
+    /** \brief The current font, used to measure the text. */
+    FontCache::Font *m_font;
+
+    /**
+     * \brief Fonts of the current family, size and stretch, indexed by weight and slant.
+     *
+     * This makes switching between bold and italic (which printers do often)
+     * cheap. Null entries haven't been looked up yet.
+     */
+    std::array<std::array<FontCache::Font*, 2>, 2> m_fontVariants;
+
+    unsigned m_fontSelections;
 
     Margins m_margins;
     PageSize m_pageSize;
@@ -174,25 +411,120 @@ private:
     double m_stretchX;
     double m_stretchY;
 
-    ICharPreprocessor *m_preprocessor;
-    std::unique_ptr<ICodepageTranslator> m_cpTranslator;
+    /** \brief Distance of the lines, zero for the line height of the font. */
+    double m_lineSpacing;
+
+    /** \brief The grid of the fixed-pitch layout, if enabled. */
+    std::optional<CellGrid> m_cellGrid;
+
+    /** \brief Horizontal position in the grid, in units of 1/GRID_UNITS_PER_INCH inch. */
+    unsigned m_gridX;
+
+    /** \brief Row in the grid. */
+    unsigned m_gridRow;
+
+    /** \brief Width between the margins in grid units. */
+    unsigned m_gridWidth;
+
+    /** \brief Number of rows that fit between the margins. */
+    unsigned m_gridRows;
+
+    static constexpr unsigned GRID_UNITS_PER_INCH = CellGrid::UNITS_PER_INCH;
+
+    static constexpr double POINTS_PER_INCH = 72.0;
+
+    /** \brief The page being laid out. */
+    PageDisplayList m_pageList;
+
+    /** \brief Index of m_style in m_pageList, if already added. */
+    std::optional<uint32_t> m_styleIndex;
 
-    void append(gunichar c);
+    IPageSink *m_sink;
+
+    /** \brief Index of the current page. */
+    unsigned m_page;
+
+    /** \brief Number of lines started so far; used to place layout checkpoints. */
+    unsigned m_lineCount;
+
+    /** \brief True if anything has been printed on the current page. */
+    bool m_pageHasContent;
 
     /**
-     * Set the current font in the Cairo surface and update m_fontExtents.
+     * \brief True if the next character continues the last text run.
      *
-     * Internally uses the m_needFontChange flag to determine if the action
-     * is really needed. If not needed, this function does nothing.
+     * Cleared whenever the position jumps or the style changes.
      */
-    void setFont();
+    bool m_textRunOpen;
+
+    /** \brief Number of spaces skipped since the last character of the open text run. */
+    size_t m_pendingSpaces;
+
+    /**
+     * \brief Longest run of spaces kept in a text run.
+     *
+     * Longer runs (typically used to align columns) just move the position
+     * and start a new text run.
+     */
+    static constexpr unsigned MAX_SPACES_IN_TEXT_RUN = 3;
 
     /**
-     * Set a specific font in the Cairo surface and update m_fontExtents.
+     * If set, only this page is recorded and passed to the sink.
+     *
+     * NO_PAGE records nothing at all.
      */
-    void setFont(const std::string &family, double size,
-        Cairo::FontSlant slant = Cairo::FONT_SLANT_NORMAL,
-        Cairo::FontWeight weight = Cairo::FONT_WEIGHT_NORMAL);
+    std::optional<unsigned> m_onlyPage;
+
+    static constexpr unsigned NO_PAGE = ~0u;
+
+    /** \brief Longest block fed at once by layoutPages() and renderPage(). */
+    static constexpr size_t LAYOUT_BLOCK_SIZE = 4096;
+
+    std::unique_ptr<ICharPreprocessor> m_preprocessor;
+    std::shared_ptr<ICodepageTranslator> m_cpTranslator;
+
+    /** \brief Buffer for translating input blocks. */
+    std::vector<TranslatedChar> m_translated;
+
+    static constexpr size_t TRANSLATE_BLOCK_SIZE = 4096;
+    std::shared_ptr<FontCache> m_fontCache;
+
+    void append(gunichar c, const char *utf8, size_t utf8Length);
+
+    /** \brief Append translated characters, passing runs of spaces to appendSpaces(). */
+    void appendTranslated(const TranslatedChar *text, size_t size);
+
+    /**
+     * Move the position by count spaces.
+     *
+     * Nothing is drawn, but the text wraps just
+     * as if the spaces were printed one by one.
+     */
+    void appendSpaces(size_t count);
+
+    bool isDrawing() const;
+    uint32_t getStyleIndex();
+    void deliverPage();
+
+    void updateGridSize();
+    unsigned getCellWidth() const;
+    void updateGridPosition();
+
+    Snapshot takeSnapshot(size_t offset) const;
+
+    /** \brief Length of the next block for layoutPages() and renderPage(): up to the end of a line. */
+    static size_t getLayoutBlockSize(const uint8_t *data, size_t size);
+    void restoreSnapshot(const Snapshot &snapshot);
+
+    void resetFontVariants();
+
+    /**
+     * Update m_font to match the font attributes.
+     *
+     * Internally uses the m_needFontChange flag to determine if the action
+     * is really needed. If not needed, this function does nothing.
+     */
+    void setFont();
 };
 
 #endif // CAIRO_TTY_H_
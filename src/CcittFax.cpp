@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CcittFax.h"
+
+#include <cstdlib>
+
+namespace
+{
+    /** \brief Variable length code, written from the most significant bit. */
+    struct Code
+    {
+        uint16_t bits;
+        uint8_t length;
+    };
+
+    /** \brief Codes of white runs of 0 to 63 pixels. */
+    const Code WHITE_TERMINATING[64] =
+    {
+        { 0x35, 8 }, { 0x7, 6 }, { 0x7, 4 }, { 0x8, 4 },
+        { 0xb, 4 }, { 0xc, 4 }, { 0xe, 4 }, { 0xf, 4 },
+        { 0x13, 5 }, { 0x14, 5 }, { 0x7, 5 }, { 0x8, 5 },
+        { 0x8, 6 }, { 0x3, 6 }, { 0x34, 6 }, { 0x35, 6 },
+        { 0x2a, 6 }, { 0x2b, 6 }, { 0x27, 7 }, { 0xc, 7 },
+        { 0x8, 7 }, { 0x17, 7 }, { 0x3, 7 }, { 0x4, 7 },
+        { 0x28, 7 }, { 0x2b, 7 }, { 0x13, 7 }, { 0x24, 7 },
+        { 0x18, 7 }, { 0x2, 8 }, { 0x3, 8 }, { 0x1a, 8 },
+        { 0x1b, 8 }, { 0x12, 8 }, { 0x13, 8 }, { 0x14, 8 },
+        { 0x15, 8 }, { 0x16, 8 }, { 0x17, 8 }, { 0x28, 8 },
+        { 0x29, 8 }, { 0x2a, 8 }, { 0x2b, 8 }, { 0x2c, 8 },
+        { 0x2d, 8 }, { 0x4, 8 }, { 0x5, 8 }, { 0xa, 8 },
+        { 0xb, 8 }, { 0x52, 8 }, { 0x53, 8 }, { 0x54, 8 },
+        { 0x55, 8 }, { 0x24, 8 }, { 0x25, 8 }, { 0x58, 8 },
+        { 0x59, 8 }, { 0x5a, 8 }, { 0x5b, 8 }, { 0x4a, 8 },
+        { 0x4b, 8 }, { 0x32, 8 }, { 0x33, 8 }, { 0x34, 8 }
+    };
+
+    /** \brief Codes of white runs of 64 to 1728 pixels, in steps of 64. */
+    const Code WHITE_MAKEUP[27] =
+    {
+        { 0x1b, 5 }, { 0x12, 5 }, { 0x17, 6 }, { 0x37, 7 },
+        { 0x36, 8 }, { 0x37, 8 }, { 0x64, 8 }, { 0x65, 8 },
+        { 0x68, 8 }, { 0x67, 8 }, { 0xcc, 9 }, { 0xcd, 9 },
+        { 0xd2, 9 }, { 0xd3, 9 }, { 0xd4, 9 }, { 0xd5, 9 },
+        { 0xd6, 9 }, { 0xd7, 9 }, { 0xd8, 9 }, { 0xd9, 9 },
+        { 0xda, 9 }, { 0xdb, 9 }, { 0x98, 9 }, { 0x99, 9 },
+        { 0x9a, 9 }, { 0x18, 6 }, { 0x9b, 9 }
+    };
+
+    /** \brief Codes of black runs of 0 to 63 pixels. */
+    const Code BLACK_TERMINATING[64] =
+    {
+        { 0x37, 10 }, { 0x2, 3 }, { 0x3, 2 }, { 0x2, 2 },
+        { 0x3, 3 }, { 0x3, 4 }, { 0x2, 4 }, { 0x3, 5 },
+        { 0x5, 6 }, { 0x4, 6 }, { 0x4, 7 }, { 0x5, 7 },
+        { 0x7, 7 }, { 0x4, 8 }, { 0x7, 8 }, { 0x18, 9 },
+        { 0x17, 10 }, { 0x18, 10 }, { 0x8, 10 }, { 0x67, 11 },
+        { 0x68, 11 }, { 0x6c, 11 }, { 0x37, 11 }, { 0x28, 11 },
+        { 0x17, 11 }, { 0x18, 11 }, { 0xca, 12 }, { 0xcb, 12 },
+        { 0xcc, 12 }, { 0xcd, 12 }, { 0x68, 12 }, { 0x69, 12 },
+        { 0x6a, 12 }, { 0x6b, 12 }, { 0xd2, 12 }, { 0xd3, 12 },
+        { 0xd4, 12 }, { 0xd5, 12 }, { 0xd6, 12 }, { 0xd7, 12 },
+        { 0x6c, 12 }, { 0x6d, 12 }, { 0xda, 12 }, { 0xdb, 12 },
+        { 0x54, 12 }, { 0x55, 12 }, { 0x56, 12 }, { 0x57, 12 },
+        { 0x64, 12 }, { 0x65, 12 }, { 0x52, 12 }, { 0x53, 12 },
+        { 0x24, 12 }, { 0x37, 12 }, { 0x38, 12 }, { 0x27, 12 },
+        { 0x28, 12 }, { 0x58, 12 }, { 0x59, 12 }, { 0x2b, 12 },
+        { 0x2c, 12 }, { 0x5a, 12 }, { 0x66, 12 }, { 0x67, 12 }
+    };
+
+    /** \brief Codes of black runs of 64 to 1728 pixels, in steps of 64. */
+    const Code BLACK_MAKEUP[27] =
+    {
+        { 0xf, 10 }, { 0xc8, 12 }, { 0xc9, 12 }, { 0x5b, 12 },
+        { 0x33, 12 }, { 0x34, 12 }, { 0x35, 12 }, { 0x6c, 13 },
+        { 0x6d, 13 }, { 0x4a, 13 }, { 0x4b, 13 }, { 0x4c, 13 },
+        { 0x4d, 13 }, { 0x72, 13 }, { 0x73, 13 }, { 0x74, 13 },
+        { 0x75, 13 }, { 0x76, 13 }, { 0x77, 13 }, { 0x52, 13 },
+        { 0x53, 13 }, { 0x54, 13 }, { 0x55, 13 }, { 0x5a, 13 },
+        { 0x5b, 13 }, { 0x64, 13 }, { 0x65, 13 }
+    };
+
+    /** \brief Codes of runs of 1792 to 2560 pixels of both colors, in steps of 64. */
+    const Code EXTENDED_MAKEUP[13] =
+    {
+        { 0x8, 11 }, { 0xc, 11 }, { 0xd, 11 }, { 0x12, 12 },
+        { 0x13, 12 }, { 0x14, 12 }, { 0x15, 12 }, { 0x16, 12 },
+        { 0x17, 12 }, { 0x1c, 12 }, { 0x1d, 12 }, { 0x1e, 12 },
+        { 0x1f, 12 }
+    };
+
+    const Code PASS = { 0x1, 4 };
+    const Code HORIZONTAL = { 0x1, 3 };
+
+    /** \brief Vertical mode codes for a1 - b1 from -3 to 3. */
+    const Code VERTICAL[7] =
+    {
+        { 0x2, 7 }, { 0x2, 6 }, { 0x2, 3 }, { 0x1, 1 }, { 0x3, 3 }, { 0x3, 6 }, { 0x3, 7 }
+    };
+
+    /** \brief End of facsimile block: two EOL codes. */
+    const Code EOL = { 0x1, 12 };
+
+    /** \brief Longest run with a makeup code (the last extended one); longer runs repeat it. */
+    const uint32_t MAX_MAKEUP_RUN = 2560;
+
+    /** \brief Collects codes into bytes. */
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t> &output):
+            m_output(output),
+            m_bits(0),
+            m_count(0)
+        {}
+
+        void put(Code code)
+        {
+            m_bits = (m_bits << code.length) | code.bits;
+            m_count += code.length;
+
+            while (m_count >= 8)
+            {
+                m_count -= 8;
+                m_output.push_back(static_cast<uint8_t>(m_bits >> m_count));
+            }
+        }
+
+        /** \brief Write the last partial byte, padded with zeros. */
+        void flush()
+        {
+            if (m_count > 0)
+                m_output.push_back(static_cast<uint8_t>(m_bits << (8 - m_count)));
+
+            m_count = 0;
+        }
+
+    private:
+        std::vector<uint8_t> &m_output;
+        uint32_t m_bits;
+        unsigned m_count;
+    };
+
+    void putRun(BitWriter &writer, uint32_t run, bool black)
+    {
+        while (run >= MAX_MAKEUP_RUN + 64)
+        {
+            writer.put(EXTENDED_MAKEUP[12]);
+            run -= MAX_MAKEUP_RUN;
+        }
+
+        if (run >= 64)
+        {
+            const uint32_t index = run / 64 - 1;
+            if (index >= 27)
+                writer.put(EXTENDED_MAKEUP[index - 27]);
+            else
+                writer.put(black ? BLACK_MAKEUP[index] : WHITE_MAKEUP[index]);
+
+            run %= 64;
+        }
+
+        writer.put(black ? BLACK_TERMINATING[run] : WHITE_TERMINATING[run]);
+    }
+
+    /**
+     * Find the changing elements of a row: the positions of the pixels
+     * differing from the pixel on their left, the one left of the row being
+     * white. Changes at even indices start black runs. The row width is
+     * appended three times, so that the coder can look past the end.
+     */
+    void findChanges(const uint8_t *row, uint32_t width, std::vector<uint32_t> &changes)
+    {
+        changes.clear();
+
+        bool black = false;
+        for (uint32_t x = 0; x < width; x += 8)
+        {
+            const uint8_t byte = row[x / 8];
+
+            // skip whole bytes of the current color
+            if (byte == (black ? 0xff : 0x00))
+                continue;
+
+            for (uint32_t bit = 0; bit < 8 && x + bit < width; bit++)
+            {
+                if (((byte & (0x80 >> bit)) != 0) != black)
+                {
+                    changes.push_back(x + bit);
+                    black = !black;
+                }
+            }
+        }
+
+        changes.insert(changes.end(), 3, width);
+    }
+}
+
+std::vector<uint8_t> encodeCcittG4(const uint8_t *rows, uint32_t width, uint32_t height, size_t stride)
+{
+    std::vector<uint8_t> output;
+    BitWriter writer(output);
+
+    // the line above the first one is white
+    std::vector<uint32_t> reference(3, width);
+    std::vector<uint32_t> coding;
+
+    for (uint32_t y = 0; y < height; y++, rows += stride)
+    {
+        findChanges(rows, width, coding);
+
+        // a0 starts on an imaginary white pixel left of the row
+        int64_t a0 = -1;
+        bool black = false;
+        size_t codingIndex = 0;
+        size_t referenceIndex = 0;
+
+        while (a0 < width)
+        {
+            while (coding[codingIndex] <= a0)
+                codingIndex++;
+            while (reference[referenceIndex] <= a0)
+                referenceIndex++;
+
+            // b1 is the first change right of a0 to the opposite color
+            size_t b1Index = referenceIndex;
+            if ((b1Index & 1) != black)
+                b1Index++;
+
+            const uint32_t a1 = coding[codingIndex];
+            const uint32_t b1 = reference[b1Index];
+            const uint32_t b2 = reference[b1Index + 1];
+
+            if (b2 < a1)
+            {
+                writer.put(PASS);
+                a0 = b2;
+            }
+            else if (std::abs(static_cast<int64_t>(a1) - b1) <= 3)
+            {
+                writer.put(VERTICAL[static_cast<int64_t>(a1) - b1 + 3]);
+                a0 = a1;
+                black = !black;
+            }
+            else
+            {
+                const uint32_t a2 = coding[codingIndex + 1];
+                const uint32_t start = a0 < 0 ? 0 : static_cast<uint32_t>(a0);
+
+                writer.put(HORIZONTAL);
+                putRun(writer, a1 - start, black);
+                putRun(writer, a2 - a1, !black);
+                a0 = a2;
+            }
+        }
+
+        reference.swap(coding);
+    }
+
+    writer.put(EOL);
+    writer.put(EOL);
+    writer.flush();
+
+    return output;
+}
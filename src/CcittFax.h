@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CCITT_FAX_H_
+#define CCITT_FAX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Compress a 1-bit image with CCITT Group 4 (T.6) fax coding.
+ *
+ * The rows are stride bytes apart, with the leftmost pixel in the most
+ * significant bit. Set bits are black. The result ends with an EOFB and is
+ * padded to whole bytes, which is what the CCITTFaxDecode PDF filter expects
+ * with K -1 and BlackIs1 true.
+ */
+std::vector<uint8_t> encodeCcittG4(const uint8_t *rows, uint32_t width, uint32_t height, size_t stride);
+
+#endif // CCITT_FAX_H_
@@ -18,8 +18,12 @@
  */
 
 #include <iostream>
+#include <fstream>
 #include <stdexcept>
 #include <string>
+#include <filesystem>
+#include <map>
+#include <thread>
 
 #include <unistd.h>
 #include <getopt.h>
@@ -27,8 +31,8 @@
 #include "CmdLineParser.h"
 #include "PageSizeFactory.h"
 #include "MarginsFactory.h"
-#include "PreprocessorFactory.h"
 #include "translators/AsciiCodepageTranslator.h"
+#include "translators/BuiltinCodepages.h"
 #include "translators/CodepageTranslator.h"
 #include "translators/IconvCodepageTranslator.h"
 
@@ -43,24 +47,50 @@ const struct option CmdLineParser::LONG_OPTIONS[] =
     {"font-face",   required_argument,  0,  'f'},
     {"font-size",   required_argument,  0,  's'},
     {"margins",     required_argument,  0,  'm'},
+    {"stats",       no_argument,        0,  'S'},
+    {"batch",       required_argument,  0,  'b'},
+    {"jobs",        required_argument,  0,  'j'},
+    {"page-jobs",   required_argument,  0,  'J'},
+    {"grid",        required_argument,  0,  'g'},
+    {"verbose",     no_argument,        0,  'v'},
+    {"quiet",       no_argument,        0,  'q'},
+    {"diagnostics", required_argument,  0,  'D'},
+    {"graphics-compression", required_argument, 0, 'G'},
+    {"raster",      required_argument,  0,  'r'},
+    {"dpi",         required_argument,  0,  'd'},
+    {"no-antialias",no_argument,        0,  'A'},
     {"help",        no_argument,        0,  'h'},
     { 0, 0, 0, 0 }
 };
 
-const char *CmdLineParser::SHORT_OPTIONS="p:lo:P:t:T:f:s:m:h";
+const char *CmdLineParser::SHORT_OPTIONS="p:lo:P:t:T:f:s:m:Sb:j:J:g:vqD:G:r:d:Ah";
+
+const std::string CmdLineParser::BUILTIN_TRANSLATOR_PREFIX = "builtin:";
 
 const char *CmdLineParser::DEFAULT_FONT_FACE = "Courier New";
 const double CmdLineParser::DEFAULT_FONT_SIZE = 11.0;
+const unsigned CmdLineParser::DEFAULT_LPI = 6;
+const double CmdLineParser::DEFAULT_RASTER_DPI = 200.0;
 
 CmdLineParser::CmdLineParser(int argc, char* const argv[]):
     m_progName((argc>0 && argv[0] != nullptr)? argv[0] : "dotprint"),
     m_pageSize(PageSizeFactory::getDefault()),
     m_pageMargins(MarginsFactory::getDefault()),
     m_isLandscape(false),
-    m_preprocessor(PreprocessorFactory::getDefault()),
+    m_preprocessorCreator(PreprocessorFactory::getDefault()),
+    m_builtinCodepage(nullptr),
     m_outputFileSet(false),
+    m_isBatch(false),
     m_fontFace(DEFAULT_FONT_FACE),
-    m_fontSize(DEFAULT_FONT_SIZE)
+    m_fontSize(DEFAULT_FONT_SIZE),
+    m_stats(false),
+    m_jobCount(1),
+    m_pageJobCount(1),
+    m_verbosity(Diagnostics::Verbosity::Summary),
+    m_diagnosticsFormat(Diagnostics::Format::Text),
+    m_graphicsCompression(GraphicsCompression::Flate),
+    m_rasterDpi(DEFAULT_RASTER_DPI),
+    m_rasterAntialias(true)
 {
     while (true)
     {
@@ -112,6 +142,54 @@ CmdLineParser::CmdLineParser(int argc, char* const argv[]):
             setPageMargins(optarg);
             break;
 
+        case 'S':
+            m_stats = true;
+            break;
+
+        case 'b':
+            readManifest(optarg);
+            break;
+
+        case 'j':
+            m_jobCount = parseJobCount(optarg);
+            break;
+
+        case 'J':
+            m_pageJobCount = parseJobCount(optarg);
+            break;
+
+        case 'g':
+            setCellGrid(optarg);
+            break;
+
+        case 'v':
+            m_verbosity = Diagnostics::Verbosity::Verbose;
+            break;
+
+        case 'q':
+            m_verbosity = Diagnostics::Verbosity::Quiet;
+            break;
+
+        case 'D':
+            setDiagnosticsFormat(optarg);
+            break;
+
+        case 'G':
+            setGraphicsCompression(optarg);
+            break;
+
+        case 'r':
+            setRasterFormat(optarg);
+            break;
+
+        case 'd':
+            setRasterDpi(optarg);
+            break;
+
+        case 'A':
+            m_rasterAntialias = false;
+            break;
+
         case 'h':
             printHelp();
             exit(1);
@@ -125,32 +203,48 @@ CmdLineParser::CmdLineParser(int argc, char* const argv[]):
         }
     }
 
-    if (!m_outputFileSet)
+    if (!m_translatorArg.empty() && !m_iconvTranslatorArg.empty())
     {
-        std::cerr << m_progName << ": you must specify an output file with --output output.pdf\n";
+        std::cerr << m_progName << ": at most one of -t and -T may be specified\n";
         exit(-1);
     }
 
-    if (!m_translatorArg.empty() && !m_iconvTranslatorArg.empty())
+    if (m_rasterFormat)
     {
-        std::cerr << m_progName << ": at most one of -t and -T may be specified\n";
-        exit(-1);
+        m_rasterOptions = RasterOptions{*m_rasterFormat, m_rasterDpi, m_rasterAntialias};
     }
 
     // optind is the index of the first file arg
-    if (optind >= argc)
+    for (int i = optind; i < argc; i++)
+    {
+        m_jobs.push_back({argv[i], std::string()});
+    }
+
+    if (m_jobs.empty())
     {
         std::cerr << m_progName << ": you must specify an input file!\n";
         exit(-1);
     }
 
-    if (optind + 1 < argc)
+    if (m_jobs.size() > 1)
     {
-        std::cerr << m_progName << ": too many input files. Only single input file is allowed.\n";
-        exit(-1);
+        m_isBatch = true;
+    }
+
+    if (m_isBatch)
+    {
+        setBatchOutputFiles();
     }
+    else
+    {
+        if (!m_outputFileSet)
+        {
+            std::cerr << m_progName << ": you must specify an output file with --output output.pdf\n";
+            exit(-1);
+        }
 
-    m_inputFile = argv[optind];
+        m_jobs.front().outputFile = m_outputFile;
+    }
 }
 
 const PageSize &CmdLineParser::getPageSize() const
@@ -168,9 +262,9 @@ bool CmdLineParser::isLandscape() const
     return m_isLandscape;
 }
 
-ICharPreprocessor *CmdLineParser::getPreprocessor() const
+std::unique_ptr<ICharPreprocessor> CmdLineParser::createPreprocessor() const
 {
-    return m_preprocessor;
+    return m_preprocessorCreator();
 }
 
 std::unique_ptr<ICodepageTranslator> CmdLineParser::getCodepageTranslator() const
@@ -180,6 +274,11 @@ std::unique_ptr<ICodepageTranslator> CmdLineParser::getCodepageTranslator() cons
         return std::make_unique<IconvCodepageTranslator>(m_iconvTranslatorArg);
     }
 
+    if (m_builtinCodepage)
+    {
+        return std::make_unique<BuiltinCodepageTranslator>(*m_builtinCodepage);
+    }
+
     if (!m_translatorArg.empty())
     {
         return std::make_unique<CodepageTranslator>(m_translatorArg);
@@ -189,14 +288,14 @@ std::unique_ptr<ICodepageTranslator> CmdLineParser::getCodepageTranslator() cons
     return std::make_unique<AsciiCodepageTranslator>();
 }
 
-const std::string &CmdLineParser::getOutputFile() const
+const std::vector<ConversionJob> &CmdLineParser::getJobs() const
 {
-    return m_outputFile;
+    return m_jobs;
 }
 
-const std::string &CmdLineParser::getInputFile() const
+bool CmdLineParser::isBatch() const
 {
-    return m_inputFile;
+    return m_isBatch;
 }
 
 const std::string &CmdLineParser::getFontFace() const
@@ -209,6 +308,46 @@ double CmdLineParser::getFontSize() const
     return m_fontSize;
 }
 
+bool CmdLineParser::isStatsEnabled() const
+{
+    return m_stats;
+}
+
+unsigned CmdLineParser::getJobCount() const
+{
+    return m_jobCount;
+}
+
+unsigned CmdLineParser::getPageJobCount() const
+{
+    return m_pageJobCount;
+}
+
+const std::optional<CellGrid> &CmdLineParser::getCellGrid() const
+{
+    return m_cellGrid;
+}
+
+Diagnostics::Verbosity CmdLineParser::getVerbosity() const
+{
+    return m_verbosity;
+}
+
+Diagnostics::Format CmdLineParser::getDiagnosticsFormat() const
+{
+    return m_diagnosticsFormat;
+}
+
+GraphicsCompression CmdLineParser::getGraphicsCompression() const
+{
+    return m_graphicsCompression;
+}
+
+const std::optional<RasterOptions> &CmdLineParser::getRasterOptions() const
+{
+    return m_rasterOptions;
+}
+
 void CmdLineParser::setPageSize(const char *arg)
 {
     if (!strcmp(arg, "list"))
@@ -285,7 +424,7 @@ void CmdLineParser::setPreprocessor(const char *arg)
         exit(0);
     }
 
-    ICharPreprocessor *p = PreprocessorFactory::lookup(arg);
+    PreprocessorFactory::TCreator p = PreprocessorFactory::lookup(arg);
 
     if (!p)
     {
@@ -293,12 +432,33 @@ void CmdLineParser::setPreprocessor(const char *arg)
         exit(1);
     }
 
-    m_preprocessor = p;
+    m_preprocessorCreator = p;
 }
 
 void CmdLineParser::setTranslator(const char *arg)
 {
     m_translatorArg = arg;
+    m_builtinCodepage = nullptr;
+
+    if (m_translatorArg.compare(0, BUILTIN_TRANSLATOR_PREFIX.size(), BUILTIN_TRANSLATOR_PREFIX) == 0)
+    {
+        const std::string name = m_translatorArg.substr(BUILTIN_TRANSLATOR_PREFIX.size());
+
+        if (name == "list")
+        {
+            std::cout << m_progName << ": built-in codepages:\n";
+            BuiltinCodepageFactory::print(std::cout);
+            exit(0);
+        }
+
+        m_builtinCodepage = BuiltinCodepageFactory::lookup(name);
+        if (!m_builtinCodepage)
+        {
+            std::cerr << m_progName << ": unknown built-in codepage. Use -t " << BUILTIN_TRANSLATOR_PREFIX
+                << "list to get a list.\n";
+            exit(1);
+        }
+    }
 }
 
 void CmdLineParser::setIconvTranslator(const char *arg)
@@ -319,19 +479,181 @@ void CmdLineParser::setFontSize(const char *arg)
     }
 }
 
+void CmdLineParser::readManifest(const char *arg)
+{
+    std::ifstream f(arg);
+    if (!f.is_open())
+    {
+        std::cerr << m_progName << ": can't open batch manifest " << arg << '\n';
+        exit(1);
+    }
+
+    // each line holds an input file, optionally followed by a tab and the output file
+    std::string line;
+    while (std::getline(f, line))
+    {
+        // tolerate manifests written with CRLF line endings
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos)
+            m_jobs.push_back({line, std::string()});
+        else
+            m_jobs.push_back({line.substr(0, tab), line.substr(tab + 1)});
+    }
+
+    if (f.bad())
+    {
+        std::cerr << m_progName << ": can't read batch manifest " << arg << '\n';
+        exit(1);
+    }
+
+    m_isBatch = true;
+}
+
+unsigned CmdLineParser::parseJobCount(const char *arg)
+{
+    int jobs;
+    if (sscanf(arg, "%d", &jobs) != 1 || jobs < 0)
+    {
+        std::cerr << m_progName << ": wrong number of jobs: " << arg << '\n';
+        exit(1);
+    }
+
+    // 0 means one job per CPU
+    return jobs > 0 ? jobs : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void CmdLineParser::setBatchOutputFiles()
+{
+    /*
+     * In batch mode the output is either named in the manifest, or it is the
+     * input file with the extension replaced by .pdf. If --output is given,
+     * it names the directory where such outputs are placed.
+     */
+    if (m_outputFileSet && !std::filesystem::is_directory(m_outputFile))
+    {
+        std::cerr << m_progName << ": with multiple input files, --output must be an existing directory\n";
+        exit(-1);
+    }
+
+    // output file (normalized) -> its input, to catch inputs of the same name in different directories
+    std::map<std::filesystem::path, std::string> outputs;
+
+    for (ConversionJob &job: m_jobs)
+    {
+        if (job.inputFile == "-" || job.outputFile == "-")
+        {
+            std::cerr << m_progName << ": stdin and stdout can't be used in batch mode\n";
+            exit(-1);
+        }
+
+        if (job.outputFile.empty())
+        {
+            std::filesystem::path output(job.inputFile);
+            if (m_outputFileSet)
+                output = std::filesystem::path(m_outputFile) / output.filename();
+            output.replace_extension(m_rasterOptions ? RasterOutput::getExtension(m_rasterOptions->format) : ".pdf");
+
+            job.outputFile = output.string();
+        }
+
+        const auto inserted = outputs.emplace(std::filesystem::absolute(job.outputFile).lexically_normal(),
+            job.inputFile);
+        if (!inserted.second)
+        {
+            std::cerr << m_progName << ": " << inserted.first->second << " and " << job.inputFile
+                << " would both be written to " << job.outputFile << '\n';
+            exit(-1);
+        }
+    }
+}
+
+void CmdLineParser::setCellGrid(const char *arg)
+{
+    try
+    {
+        m_cellGrid = CellGrid::parse(arg, DEFAULT_LPI);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << m_progName << ": " << e.what() << '\n';
+        exit(1);
+    }
+}
+
+void CmdLineParser::setDiagnosticsFormat(const char *arg)
+{
+    try
+    {
+        m_diagnosticsFormat = Diagnostics::lookupFormat(arg);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << m_progName << ": " << e.what() << '\n';
+        exit(1);
+    }
+}
+
+void CmdLineParser::setGraphicsCompression(const char *arg)
+{
+    try
+    {
+        m_graphicsCompression = PageRenderer::lookupGraphicsCompression(arg);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << m_progName << ": " << e.what() << '\n';
+        exit(1);
+    }
+}
+
+void CmdLineParser::setRasterFormat(const char *arg)
+{
+    try
+    {
+        m_rasterFormat = RasterOutput::lookupFormat(arg);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << m_progName << ": " << e.what() << '\n';
+        exit(1);
+    }
+}
+
+void CmdLineParser::setRasterDpi(const char *arg)
+{
+    if (sscanf(arg, "%lf", &m_rasterDpi) != 1 || !(m_rasterDpi > 0.0))
+    {
+        std::cerr << m_progName << ": wrong resolution: " << arg << '\n';
+        exit(1);
+    }
+}
+
 void CmdLineParser::printHelp()
 {
     std::cout <<
         "Usage: " << m_progName << " [OPTION]... INPUT_FILE -o OUTPUT_FILE\n"
+        "   or: " << m_progName << " [OPTION]... INPUT_FILE... [-o OUTPUT_DIR]\n"
+        "   or: " << m_progName << " [OPTION]... -b MANIFEST [-o OUTPUT_DIR]\n"
         "Convert input text file into a PDF.\n"
-        "  -o, --output        Specify output file (PDF). Required.\n"
+        "Use \"-\" as INPUT_FILE to read stdin and as OUTPUT_FILE to write to stdout.\n"
+        "With multiple input files, each is converted into a PDF of the same name\n"
+        "with a .pdf extension, placed in OUTPUT_DIR if given.\n"
+        "  -o, --output        Specify output file (PDF). Required for a single input.\n"
         "  -p, --page          Specify page size.\n"
         "                      Use \"-p list\" to see available values.\n"
         "  -l, --landscape     Set landscape mode.\n"
         "  -P, --preprocessor  Select preprocessor to use.\n"
         "                      Use \"-P list\" to see available values.\n"
         "  -t, --translator    Select codepage translator to use.\n"
-        "                      Use a translation file as argument.\n"
+        "                      Use a translation file as argument, or\n"
+        "                      " << BUILTIN_TRANSLATOR_PREFIX << "NAME for a built-in codepage.\n"
+        "                      Use \"-t " << BUILTIN_TRANSLATOR_PREFIX << "list\" to see the built-in codepages.\n"
         "  -T, --iconv-translator Use iconv for translating the input.\n"
         "                      Use a character set name that iconv can recognize\n"
         "                      like CP850. Only single-byte encodings are supported.\n"
@@ -342,5 +664,35 @@ void CmdLineParser::printHelp()
         "  -m, --margins       Set page margins (in millimeters).\n"
         "                      Use \"-m formats\" to see available formats.\n"
         "                      Default value: " << MarginsFactory::DEFAULT_MARGIN_VALUE << " mm for all margins.\n"
+        "  -b, --batch         Convert all files listed in a manifest file. Each line\n"
+        "                      holds an input file, optionally followed by a tab\n"
+        "                      and the output file.\n"
+        "  -j, --jobs          Number of files to convert in parallel (batch mode).\n"
+        "                      Use 0 for one job per CPU. Default value: 1\n"
+        "  -J, --page-jobs     Number of threads rendering the pages of one file\n"
+        "                      (PDF pages, or page images with --raster).\n"
+        "                      Use 0 for one thread per CPU. Default value: 1\n"
+        "  -g, --grid          Lay out the text in a fixed-pitch character grid\n"
+        "                      given as CPI[/LPI], e.g. 10/6 or 8.5. Condensed and\n"
+        "                      expanded text gets narrower and wider cells.\n"
+        "                      Default LPI: " << DEFAULT_LPI << "\n"
+        "  -S, --stats         Print per-file and total throughput to stderr.\n"
+        "  -v, --verbose       Report each kind of problem in the input (unknown\n"
+        "                      characters or escapes) when it is first seen.\n"
+        "  -q, --quiet         Don't report problems in the input.\n"
+        "  -D, --diagnostics   Format of the summary of problems in the input\n"
+        "                      printed to stderr: text or tsv (source, byte, count).\n"
+        "                      Default value: text\n"
+        "  -G, --graphics-compression Compression of bit image graphics in the PDF:\n"
+        "                      flate, or ccitt to use CCITT Group 4 for the images\n"
+        "                      it makes smaller.\n"
+        "                      Default value: flate\n"
+        "  -r, --raster        Write page images instead of a PDF: png (grayscale, a\n"
+        "                      file per page if there are more pages: out-1.png,\n"
+        "                      out-2.png), pbm or tiff (1-bit, CCITT G4, all pages\n"
+        "                      in one file).\n"
+        "  -d, --dpi           Resolution of the page images.\n"
+        "                      Default value: " << DEFAULT_RASTER_DPI << "\n"
+        "  -A, --no-antialias  Draw the page images with sharp edges.\n"
         "  -h, --help          Display this help.\n";
 }
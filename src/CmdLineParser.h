@@ -22,8 +22,23 @@
 
 #include <string>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include "CairoTTY.h"
+#include "Diagnostics.h"
+#include "PageRenderer.h"
+#include "PreprocessorFactory.h"
+#include "RasterOutput.h"
+
+/** \brief Input and output file of a single conversion. */
+struct ConversionJob
+{
+    std::string inputFile;
+    std::string outputFile;
+};
+
+struct BuiltinCodepage;
 
 class CmdLineParser
 {
@@ -32,12 +47,22 @@ public:
     const PageSize &getPageSize() const;
     const Margins &getPageMargins() const;
     bool isLandscape() const;
-    const std::string & getOutputFile() const;
-    const std::string & getInputFile() const;
-    ICharPreprocessor * getPreprocessor() const;
+    const std::vector<ConversionJob> & getJobs() const;
+    bool isBatch() const;
+    std::unique_ptr<ICharPreprocessor> createPreprocessor() const;
     std::unique_ptr<ICodepageTranslator> getCodepageTranslator() const;
     const std::string & getFontFace() const;
     double getFontSize() const;
+    bool isStatsEnabled() const;
+    unsigned getJobCount() const;
+    unsigned getPageJobCount() const;
+    const std::optional<CellGrid> &getCellGrid() const;
+    Diagnostics::Verbosity getVerbosity() const;
+    Diagnostics::Format getDiagnosticsFormat() const;
+    GraphicsCompression getGraphicsCompression() const;
+
+    /** \brief Set if the pages are to be written as images instead of a PDF. */
+    const std::optional<RasterOptions> &getRasterOptions() const;
 
 protected:
     void setPageSize(const char *arg);
@@ -47,6 +72,14 @@ protected:
     void setIconvTranslator(const char *arg);
     void setFontFace(const char *arg);
     void setFontSize(const char *arg);
+    void readManifest(const char *arg);
+    unsigned parseJobCount(const char *arg);
+    void setCellGrid(const char *arg);
+    void setDiagnosticsFormat(const char *arg);
+    void setGraphicsCompression(const char *arg);
+    void setRasterFormat(const char *arg);
+    void setRasterDpi(const char *arg);
+    void setBatchOutputFiles();
 
     void printHelp();
 
@@ -54,22 +87,40 @@ private:
     static const struct option LONG_OPTIONS[];
     static const char *SHORT_OPTIONS;
 
+    /** \brief Prefix of the -t argument selecting a built-in codepage. */
+    static const std::string BUILTIN_TRANSLATOR_PREFIX;
+
     static const char *DEFAULT_FONT_FACE;
     static const double DEFAULT_FONT_SIZE;
+    static const unsigned DEFAULT_LPI;
+    static const double DEFAULT_RASTER_DPI;
 
     const std::string m_progName;
 
     PageSize m_pageSize;
     Margins m_pageMargins;
     bool m_isLandscape;
-    ICharPreprocessor *m_preprocessor;
+    PreprocessorFactory::TCreator m_preprocessorCreator;
     std::string m_translatorArg;
+    const BuiltinCodepage *m_builtinCodepage;
     std::string m_iconvTranslatorArg;
     std::string m_outputFile;
     bool m_outputFileSet;
-    std::string m_inputFile;
+    std::vector<ConversionJob> m_jobs;
+    bool m_isBatch;
     std::string m_fontFace;
     double m_fontSize;
+    bool m_stats;
+    unsigned m_jobCount;
+    unsigned m_pageJobCount;
+    std::optional<CellGrid> m_cellGrid;
+    Diagnostics::Verbosity m_verbosity;
+    Diagnostics::Format m_diagnosticsFormat;
+    GraphicsCompression m_graphicsCompression;
+    std::optional<RasterFormat> m_rasterFormat;
+    double m_rasterDpi;
+    bool m_rasterAntialias;
+    std::optional<RasterOptions> m_rasterOptions;
 };
 
 #endif // CMD_LINE_PARSER_H_
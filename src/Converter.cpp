@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Converter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "InputFile.h"
+#include "PageRenderer.h"
+#include "RasterOutput.h"
+#include "WorkerPool.h"
+
+namespace
+{
+    /**
+     * \brief Encodes the pages as images and writes them in order.
+     *
+     * The pages are collected in batches of one page per thread. Each batch
+     * is encoded in parallel and written out before the next one starts, so
+     * only a batch of pages is kept in memory.
+     */
+    class RasterPageSink final: public IPageSink
+    {
+    public:
+        RasterPageSink(RasterOutput &output, unsigned jobCount):
+            m_output(output),
+            m_pages(std::max(1u, jobCount)),
+            m_encodedPages(m_pages.size()),
+            m_pageCount(0)
+        {
+            // the font caches may not be shared between threads, so each thread gets its own
+            for (size_t i = 0; i < m_pages.size(); i++)
+                m_fontCaches.push_back(output.createFontCache());
+        }
+
+        virtual void addPage(const PageDisplayList &page) override
+        {
+            m_pages[m_pageCount++] = page;
+            if (m_pageCount == m_pages.size())
+                flush();
+        }
+
+        /** \brief Encode and write the pages collected so far. */
+        void flush()
+        {
+            if (m_pageCount == 0)
+                return;
+
+            std::atomic<size_t> nextFontCache(0);
+            runWorkerPool(m_pageCount, static_cast<unsigned>(m_pages.size()), [&]()
+            {
+                std::shared_ptr<FontCache> fontCache = m_fontCaches[nextFontCache++];
+
+                return [this, fontCache](size_t page)
+                {
+                    m_encodedPages[page] = m_output.encodePage(m_pages[page], fontCache);
+                };
+            });
+
+            for (size_t page = 0; page < m_pageCount; page++)
+                m_output.writePage(std::move(m_encodedPages[page]));
+
+            m_pageCount = 0;
+        }
+
+    private:
+        RasterOutput &m_output;
+        std::vector<std::shared_ptr<FontCache>> m_fontCaches;
+        std::vector<PageDisplayList> m_pages;
+        std::vector<std::vector<uint8_t>> m_encodedPages;
+        size_t m_pageCount;
+    };
+}
+
+const std::string Converter::STD_STREAM_NAME = "-";
+
+Converter::Converter(const CmdLineParser &cmdline):
+    m_cmdline(cmdline),
+    m_pageSize(cmdline.getPageSize()),
+    m_margins(cmdline.getPageMargins()),
+    m_fontFace(cmdline.getFontFace()),
+    m_fontSize(cmdline.getFontSize()),
+    m_translator(cmdline.getCodepageTranslator()),
+    m_fontCache(std::make_shared<FontCache>())
+{
+    if (cmdline.isLandscape())
+        m_pageSize.rotate();
+}
+
+ConversionStats Converter::convert(const ConversionJob &job)
+{
+    if (m_cmdline.getRasterOptions())
+    {
+        return convertRaster(job);
+    }
+
+    if (m_cmdline.getPageJobCount() > 1)
+    {
+        return convertPageParallel(job);
+    }
+
+    InputFile input(job.inputFile);
+    ConversionStats stats;
+
+    std::optional<BufferedWriter> stdoutWriter;
+    Cairo::RefPtr<Cairo::PdfSurface> cs = createSurface(job.outputFile, stdoutWriter);
+
+    {
+        PageRenderer renderer(cs, m_fontCache, true, m_cmdline.getGraphicsCompression());
+        CairoTTY ctty(m_pageSize, m_margins, m_cmdline.createPreprocessor(), m_translator, m_fontCache, &renderer);
+        setupTTY(ctty);
+
+        const uint8_t *data;
+        size_t size;
+        while (input.read(data, size))
+        {
+            ctty.write(data, size);
+        }
+
+        ctty.finish();
+        stats.fontSelections = ctty.getFontSelectionCount();
+    }
+
+    finishSurface(cs, stdoutWriter);
+
+    stats.bytesRead = input.getBytesRead();
+    return stats;
+}
+
+ConversionStats Converter::convertPageParallel(const ConversionJob &job)
+{
+    InputFile input(job.inputFile);
+
+    const uint8_t *data;
+    size_t size;
+    input.readAll(data, size);
+
+    ConversionStats stats;
+
+    // find where the pages start; this is sequential, but nothing is recorded
+    CairoTTY::PageLayout layout;
+    {
+        CairoTTY ctty(m_pageSize, m_margins, m_cmdline.createPreprocessor(), m_translator, m_fontCache, nullptr);
+        setupTTY(ctty);
+
+        // the layout pass sees the whole input once; the page replays would count the same fonts again
+        layout = ctty.layoutPages(data, size);
+        stats.fontSelections = ctty.getFontSelectionCount();
+    }
+
+    // record the pages in parallel
+    const Cairo::Rectangle pageRectangle = { 0.0, 0.0, m_pageSize.width, m_pageSize.height };
+    std::vector<Cairo::RefPtr<Cairo::RecordingSurface>> pages(layout.pageStarts.size());
+
+    runWorkerPool(pages.size(), m_cmdline.getPageJobCount(), [&]()
+    {
+        // neither the translator nor the font cache may be shared between threads
+        std::shared_ptr<ICodepageTranslator> translator = m_cmdline.getCodepageTranslator();
+        auto fontCache = std::make_shared<FontCache>();
+
+        return [&, translator, fontCache](size_t page)
+        {
+            auto recording = Cairo::RecordingSurface::create(pageRectangle);
+            {
+                PageRenderer renderer(recording, fontCache, false, m_cmdline.getGraphicsCompression());
+                CairoTTY ctty(m_pageSize, m_margins, nullptr, translator, fontCache, &renderer);
+                setupTTY(ctty); // renderPage() then restores the state of the page start
+                ctty.renderPage(data, size, layout.pageStarts[page], page);
+            }
+            pages[page] = recording;
+        };
+    });
+
+    // and put them together in order
+    std::optional<BufferedWriter> stdoutWriter;
+    Cairo::RefPtr<Cairo::PdfSurface> cs = createSurface(job.outputFile, stdoutWriter);
+
+    {
+        Cairo::RefPtr<Cairo::Context> context = Cairo::Context::create(cs);
+
+        for (size_t page = 0; page < pages.size(); page++)
+        {
+            const bool isLast = page + 1 == pages.size();
+
+            // an empty last page would be dropped by cairo when not drawing in parallel
+            if (isLast && layout.lastPageEmpty)
+                break;
+
+            context->set_source(pages[page], 0.0, 0.0);
+            context->paint();
+
+            if (!isLast)
+                context->show_page();
+        }
+    }
+
+    finishSurface(cs, stdoutWriter);
+
+    stats.bytesRead = input.getBytesRead();
+    return stats;
+}
+
+ConversionStats Converter::convertRaster(const ConversionJob &job)
+{
+    InputFile input(job.inputFile);
+    ConversionStats stats;
+
+    RasterOutput output(*m_cmdline.getRasterOptions(), m_pageSize);
+    output.open(job.outputFile);
+
+    RasterPageSink sink(output, m_cmdline.getPageJobCount());
+    {
+        CairoTTY ctty(m_pageSize, m_margins, m_cmdline.createPreprocessor(), m_translator, m_fontCache, &sink);
+        setupTTY(ctty);
+
+        const uint8_t *data;
+        size_t size;
+        while (input.read(data, size))
+        {
+            ctty.write(data, size);
+        }
+
+        ctty.finish();
+        stats.fontSelections = ctty.getFontSelectionCount();
+    }
+
+    sink.flush();
+    output.close();
+
+    stats.bytesRead = input.getBytesRead();
+    return stats;
+}
+
+Cairo::RefPtr<Cairo::PdfSurface> Converter::createSurface(const std::string &outputFile,
+    std::optional<BufferedWriter> &stdoutWriter)
+{
+    Cairo::RefPtr<Cairo::PdfSurface> cs;
+    if (outputFile == STD_STREAM_NAME)
+    {
+        stdoutWriter.emplace(STDOUT_FILENO);
+        cs = Cairo::PdfSurface::create_for_stream(sigc::mem_fun(*stdoutWriter, &BufferedWriter::write),
+            m_pageSize.width, m_pageSize.height);
+    }
+    else
+    {
+        cs = Cairo::PdfSurface::create(outputFile, m_pageSize.width, m_pageSize.height);
+    }
+
+    if (!cs)
+    {
+        throw std::runtime_error("Can't create cairo PdfSurface");
+    }
+
+    return cs;
+}
+
+void Converter::finishSurface(const Cairo::RefPtr<Cairo::PdfSurface> &cs, std::optional<BufferedWriter> &stdoutWriter)
+{
+    cs->finish();
+
+    if (stdoutWriter)
+    {
+        stdoutWriter->flush();
+    }
+}
+
+void Converter::setupTTY(CairoTTY &ctty)
+{
+    ctty.setFontName(m_fontFace);
+    ctty.setFontSize(m_fontSize);
+    if (m_cmdline.getCellGrid())
+        ctty.setCellGrid(*m_cmdline.getCellGrid());
+    ctty.home();
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONVERTER_H_
+#define CONVERTER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "BufferedWriter.h"
+#include "CairoTTY.h"
+#include "CmdLineParser.h"
+#include "FontCache.h"
+
+/** \brief Statistics of a single conversion. */
+struct ConversionStats
+{
+    /** \brief Number of input bytes processed. */
+    uint64_t bytesRead = 0;
+
+    /** \brief Number of times the layout switched to a different font. */
+    uint64_t fontSelections = 0;
+};
+
+/**
+ * \brief Converts input files into PDFs, or page images in raster mode.
+ *
+ * The page geometry, codepage translator and font faces are set up once
+ * when the Converter is created and are reused by all subsequent calls
+ * to convert(). Each conversion gets a fresh preprocessor.
+ *
+ * A Converter must only be used by one thread at a time. To convert in
+ * parallel, create one Converter per thread.
+ */
+class Converter
+{
+public:
+    explicit Converter(const CmdLineParser &cmdline);
+
+    /**
+     * Convert a single input file into a PDF.
+     *
+     * Returns statistics of the conversion. Throws on errors.
+     */
+    ConversionStats convert(const ConversionJob &job);
+
+    /** \brief File name that stands for stdin or stdout. */
+    static const std::string STD_STREAM_NAME;
+
+private:
+    /**
+     * Convert a single input file, rendering its pages on multiple threads.
+     *
+     * The whole input is laid out first to find where the pages start. Then
+     * each page is recorded separately and finally the pages are painted
+     * into the PDF in order.
+     */
+    ConversionStats convertPageParallel(const ConversionJob &job);
+
+    /**
+     * Convert a single input file into page images.
+     *
+     * The input is laid out into display lists, which are rendered and
+     * encoded in batches on multiple threads (--page-jobs). Each batch is
+     * written out in order as soon as it's done.
+     */
+    ConversionStats convertRaster(const ConversionJob &job);
+
+    Cairo::RefPtr<Cairo::PdfSurface> createSurface(const std::string &outputFile,
+        std::optional<BufferedWriter> &stdoutWriter);
+    void finishSurface(const Cairo::RefPtr<Cairo::PdfSurface> &cs, std::optional<BufferedWriter> &stdoutWriter);
+    void setupTTY(CairoTTY &ctty);
+
+    const CmdLineParser &m_cmdline;
+
+    PageSize m_pageSize;
+    Margins m_margins;
+    std::string m_fontFace;
+    double m_fontSize;
+
+    std::shared_ptr<ICodepageTranslator> m_translator;
+    std::shared_ptr<FontCache> m_fontCache;
+};
+
+#endif // CONVERTER_H_
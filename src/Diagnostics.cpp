@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Diagnostics.h"
+
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+    constexpr size_t SOURCE_COUNT = static_cast<size_t>(DiagnosticSource::Count);
+
+    struct SourceDescription
+    {
+        const char *name;
+        const char *message;
+    };
+
+    constexpr std::array<SourceDescription, SOURCE_COUNT> SOURCES =
+    {{
+        { "AsciiCodepageTranslator", "dropping unknown character" },
+        { "BuiltinCodepageTranslator", "dropping unknown character" },
+        { "CodepageTranslator", "dropping unknown character" },
+        { "IconvCodepageTranslator", "can't convert character" },
+        { "SimplePreprocessor", "ignoring unknown character" },
+        { "CRLFPreprocessor", "ignoring unknown character" },
+        { "EpsonPreprocessor", "ignoring unknown escape ESC" },
+        { "CairoTTY", "cannot print character" }
+    }};
+
+    std::atomic<Diagnostics::Verbosity> verbosity(Diagnostics::Verbosity::Summary);
+
+    // zero-initialized, being static
+    std::array<std::array<std::atomic<uint64_t>, 256>, SOURCE_COUNT> counts;
+
+    // serializes the messages printed in verbose mode
+    std::mutex outputMutex;
+
+    // number of Suppressor instances of the thread
+    thread_local unsigned suppressors = 0;
+
+    void printCode(std::ostream &s, uint8_t code)
+    {
+        s << "0x" << std::setfill('0') << std::setw(2) << std::hex << static_cast<unsigned>(code) << std::dec;
+    }
+}
+
+void Diagnostics::setVerbosity(Verbosity v)
+{
+    verbosity = v;
+}
+
+Diagnostics::Verbosity Diagnostics::getVerbosity()
+{
+    return verbosity;
+}
+
+void Diagnostics::report(DiagnosticSource source, uint8_t code, const char *detail)
+{
+    if (suppressors > 0)
+        return;
+
+    const size_t index = static_cast<size_t>(source);
+
+    // only the first occurrence is ever printed right away
+    if (counts[index][code]++ == 0 && verbosity == Verbosity::Verbose)
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+
+        std::cerr << SOURCES[index].name << ": " << SOURCES[index].message << ' ';
+        printCode(std::cerr, code);
+        if (detail)
+            std::cerr << ": " << detail;
+        std::cerr << '\n';
+    }
+}
+
+uint64_t Diagnostics::getCount(DiagnosticSource source, uint8_t code)
+{
+    return counts[static_cast<size_t>(source)][code];
+}
+
+void Diagnostics::printSummary(std::ostream &s, Format format)
+{
+    for (size_t index = 0; index < SOURCE_COUNT; index++)
+    {
+        for (unsigned code = 0; code < 256; code++)
+        {
+            const uint64_t count = counts[index][code];
+            if (count == 0)
+                continue;
+
+            if (format == Format::Tsv)
+            {
+                s << SOURCES[index].name << '\t';
+                printCode(s, static_cast<uint8_t>(code));
+                s << '\t' << count << '\n';
+            }
+            else
+            {
+                s << SOURCES[index].name << ": " << SOURCES[index].message << ' ';
+                printCode(s, static_cast<uint8_t>(code));
+                s << ": " << count << (count == 1 ? " time\n" : " times\n");
+            }
+        }
+    }
+}
+
+Diagnostics::Format Diagnostics::lookupFormat(const std::string &name)
+{
+    if (name == "text")
+        return Format::Text;
+    if (name == "tsv")
+        return Format::Tsv;
+
+    throw std::runtime_error("Unknown diagnostics format: " + name);
+}
+
+Diagnostics::Suppressor::Suppressor()
+{
+    suppressors++;
+}
+
+Diagnostics::Suppressor::~Suppressor()
+{
+    suppressors--;
+}
+
+void Diagnostics::clear()
+{
+    for (auto &sourceCounts: counts)
+    {
+        for (auto &count: sourceCounts)
+            count = 0;
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIAGNOSTICS_H_
+#define DIAGNOSTICS_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/** \brief Part of dotprint reporting a diagnostic. Each has its own message. */
+enum class DiagnosticSource
+{
+    AsciiCodepageTranslator,
+    BuiltinCodepageTranslator,
+    CodepageTranslator,
+    IconvCodepageTranslator,
+    SimplePreprocessor,
+    CRLFPreprocessor,
+    EpsonPreprocessor,
+    CairoTTY,
+
+    Count
+};
+
+/**
+ * \brief Collects the problems found in the input.
+ *
+ * A bad input (e.g. a binary file or a wrong codepage) can contain millions
+ * of bytes that can't be printed. Instead of printing a message for each,
+ * the occurrences are counted per source and byte (or escape command) and a
+ * summary is printed once the conversion is done.
+ *
+ * The counters are shared by all threads.
+ */
+class Diagnostics
+{
+public:
+    enum class Verbosity
+    {
+        /** \brief Print nothing. */
+        Quiet,
+
+        /** \brief Print the summary at the end. */
+        Summary,
+
+        /** \brief Also print each problem when it occurs for the first time. */
+        Verbose
+    };
+
+    enum class Format
+    {
+        /** \brief One line of text per problem. */
+        Text,
+
+        /** \brief Tab separated source, code and count; for scripts. */
+        Tsv
+    };
+
+    static void setVerbosity(Verbosity verbosity);
+    static Verbosity getVerbosity();
+
+    /**
+     * Count an occurrence of a problem with the given byte.
+     *
+     * The detail, if given, is printed along with the first occurrence in
+     * verbose mode.
+     */
+    static void report(DiagnosticSource source, uint8_t code, const char *detail = nullptr);
+
+    static uint64_t getCount(DiagnosticSource source, uint8_t code);
+
+    /** \brief Print the problems counted so far. Prints nothing if there are none. */
+    static void printSummary(std::ostream &s, Format format);
+
+    /** \brief Look up a format by name, throws if it's not known. */
+    static Format lookupFormat(const std::string &name);
+
+    /** \brief Forget everything counted so far. */
+    static void clear();
+
+    /**
+     * \brief Ignores the reports made by the current thread while it exists.
+     *
+     * Used when input that has been processed already is processed again,
+     * so that its problems are not counted twice.
+     */
+    class Suppressor
+    {
+    public:
+        Suppressor();
+        ~Suppressor();
+
+        Suppressor(const Suppressor &) = delete;
+        Suppressor &operator=(const Suppressor &) = delete;
+    };
+
+    Diagnostics() = delete;
+};
+
+#endif // DIAGNOSTICS_H_
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DisplayList.h"
+
+uint32_t PageDisplayList::addStyle(const TextStyle &style)
+{
+    // there are just a few styles on a page, a linear search is good enough
+    for (size_t i = 0; i < m_styles.size(); i++)
+    {
+        if (m_styles[i] == style)
+            return static_cast<uint32_t>(i);
+    }
+
+    m_styles.push_back(style);
+    return static_cast<uint32_t>(m_styles.size() - 1);
+}
+
+void PageDisplayList::addText(double x, double y, uint32_t style, const char *utf8, size_t length, double cellWidth)
+{
+    m_textRuns.push_back({x, y, style, static_cast<uint32_t>(m_text.size()), static_cast<uint32_t>(length), cellWidth});
+    m_text.append(utf8, length);
+}
+
+void PageDisplayList::appendText(const char *utf8, size_t length)
+{
+    m_textRuns.back().textLength += static_cast<uint32_t>(length);
+    m_text.append(utf8, length);
+}
+
+void PageDisplayList::addBitmap(double x, double y, double dotWidth, double dotHeight, uint32_t width,
+    uint32_t height, const uint8_t *rows, size_t stride)
+{
+    m_bitmaps.push_back({x, y, dotWidth, dotHeight, width, height, static_cast<uint32_t>(m_bitmapData.size())});
+
+    const size_t rowSize = (width + 7) / 8;
+    for (uint32_t row = 0; row < height; row++)
+    {
+        m_bitmapData.insert(m_bitmapData.end(), rows + row * stride, rows + row * stride + rowSize);
+    }
+}
+
+void PageDisplayList::addRule(const Rule &rule)
+{
+    // continue the previous rule if this one just extends it
+    if (!m_rules.empty())
+    {
+        Rule &last = m_rules.back();
+        if (last.x2 == rule.x1 && last.y == rule.y && last.width == rule.width)
+        {
+            last.x2 = rule.x2;
+            return;
+        }
+    }
+
+    m_rules.push_back(rule);
+}
+
+bool PageDisplayList::empty() const
+{
+    return m_textRuns.empty() && m_rules.empty() && m_bitmaps.empty();
+}
+
+void PageDisplayList::clear()
+{
+    m_styles.clear();
+    m_textRuns.clear();
+    m_rules.clear();
+    m_bitmaps.clear();
+    m_text.clear();
+    m_bitmapData.clear();
+}
+
+const std::vector<TextStyle> &PageDisplayList::getStyles() const
+{
+    return m_styles;
+}
+
+const std::vector<TextRun> &PageDisplayList::getTextRuns() const
+{
+    return m_textRuns;
+}
+
+const std::vector<Rule> &PageDisplayList::getRules() const
+{
+    return m_rules;
+}
+
+const std::vector<Bitmap> &PageDisplayList::getBitmaps() const
+{
+    return m_bitmaps;
+}
+
+const std::string &PageDisplayList::getText() const
+{
+    return m_text;
+}
+
+const std::vector<uint8_t> &PageDisplayList::getBitmapData() const
+{
+    return m_bitmapData;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISPLAY_LIST_H_
+#define DISPLAY_LIST_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class FontWeight
+{
+    Normal,
+    Bold
+};
+
+enum class FontSlant
+{
+    Normal,
+    Italic
+};
+
+/** \brief Font and scaling used to draw a text run. */
+struct TextStyle
+{
+    std::string fontName;
+    double fontSize;
+    FontWeight fontWeight;
+    FontSlant fontSlant;
+    double stretchX;
+    double stretchY;
+
+    bool operator==(const TextStyle &other) const
+    {
+        return fontName == other.fontName && fontSize == other.fontSize && fontWeight == other.fontWeight
+            && fontSlant == other.fontSlant && stretchX == other.stretchX && stretchY == other.stretchY;
+    }
+};
+
+/** \brief Text drawn starting at a given point of the baseline. */
+struct TextRun
+{
+    double x;
+    double y;
+
+    /** \brief Index into PageDisplayList::getStyles(). */
+    uint32_t style;
+
+    /** \brief Position of the UTF-8 text in PageDisplayList::getText(). */
+    uint32_t textOffset;
+    uint32_t textLength;
+
+    /**
+     * \brief Distance between the characters of fixed-pitch text.
+     *
+     * Zero if the characters are placed by their advances.
+     */
+    double cellWidth;
+};
+
+/**
+ * \brief 1-bit image, e.g. a band of printer graphics.
+ *
+ * Set bits are drawn in the text color, the rest is transparent.
+ */
+struct Bitmap
+{
+    /** \brief Top left corner. */
+    double x;
+    double y;
+
+    /** \brief Size of one dot. */
+    double dotWidth;
+    double dotHeight;
+
+    /** \brief Size in dots. */
+    uint32_t width;
+    uint32_t height;
+
+    /**
+     * \brief Position of the rows in PageDisplayList::getBitmapData().
+     *
+     * Each row takes (width + 7) / 8 bytes, the leftmost dot is in the most
+     * significant bit.
+     */
+    uint32_t dataOffset;
+};
+
+/** \brief Horizontal line, e.g. an underline. */
+struct Rule
+{
+    double x1;
+    double x2;
+    double y;
+    double width;
+};
+
+/**
+ * \brief Everything that is drawn on one page.
+ *
+ * The page is filled by CairoTTY and drawn by a PageRenderer. Items are
+ * kept in flat arrays; the text of all runs shares one buffer and styles
+ * are referred to by index.
+ */
+class PageDisplayList
+{
+public:
+    /** \brief Get the index of the style, adding it to the page if needed. */
+    uint32_t addStyle(const TextStyle &style);
+
+    void addText(double x, double y, uint32_t style, const char *utf8, size_t length, double cellWidth = 0.0);
+
+    /**
+     * Append text to the last text run.
+     *
+     * The text must directly follow the run and share its style. There must
+     * be a text run on the page already.
+     */
+    void appendText(const char *utf8, size_t length);
+
+    /** \brief Add a bitmap, copying the rows (each stride bytes apart). */
+    void addBitmap(double x, double y, double dotWidth, double dotHeight, uint32_t width, uint32_t height,
+        const uint8_t *rows, size_t stride);
+
+    /** \brief Add a rule. A rule continuing the previous one just extends it. */
+    void addRule(const Rule &rule);
+
+    bool empty() const;
+    void clear();
+
+    const std::vector<TextStyle> &getStyles() const;
+    const std::vector<TextRun> &getTextRuns() const;
+    const std::vector<Rule> &getRules() const;
+    const std::vector<Bitmap> &getBitmaps() const;
+    const std::string &getText() const;
+    const std::vector<uint8_t> &getBitmapData() const;
+
+private:
+    std::vector<TextStyle> m_styles;
+    std::vector<TextRun> m_textRuns;
+    std::vector<Rule> m_rules;
+    std::vector<Bitmap> m_bitmaps;
+    std::string m_text;
+    std::vector<uint8_t> m_bitmapData;
+};
+
+/** \brief Receiver of finished pages. */
+class IPageSink
+{
+public:
+    /** \brief Called for each finished page, in order. */
+    virtual void addPage(const PageDisplayList &page) = 0;
+
+    virtual ~IPageSink() = default;
+};
+
+#endif // DISPLAY_LIST_H_
@@ -18,54 +18,91 @@
  */
 
 #include <iostream>
-#include <fstream>
+#include <iomanip>
 #include <stdexcept>
+#include <chrono>
+#include <atomic>
+#include <mutex>
 
-#include <assert.h>
+#include "CmdLineParser.h"
+#include "Converter.h"
+#include "Diagnostics.h"
+#include "WorkerPool.h"
 
-#include <getopt.h>
+namespace
+{
+    void printStats(const std::string &name, const ConversionStats &stats, std::chrono::steady_clock::duration elapsed)
+    {
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        const double bytesPerSecond = seconds > 0.0 ? stats.bytesRead / seconds : 0.0;
 
-#include "CairoTTY.h"
-#include "PageSizeFactory.h"
-#include "CmdLineParser.h"
+        std::cerr << name << ": " << stats.bytesRead << " bytes in " << std::fixed << std::setprecision(3) << seconds
+            << " s (" << std::setprecision(0) << bytesPerSecond << " bytes/s), "
+            << stats.fontSelections << " font selections\n";
+    }
+}
 
 int main(int argc, char *argv[])
 {
     CmdLineParser cmdline(argc, argv);
+    Diagnostics::setVerbosity(cmdline.getVerbosity());
 
-    PageSize p = cmdline.getPageSize();
-    if (cmdline.isLandscape())
-        p.rotate();
+    const std::vector<ConversionJob> &jobs = cmdline.getJobs();
 
-    ICharPreprocessor *preprocessor = cmdline.getPreprocessor();
-    auto translator = cmdline.getCodepageTranslator();
+    std::atomic<int> result(0);
+    std::atomic<size_t> converted(0);
+    std::atomic<uint64_t> totalBytes(0);
+    std::atomic<uint64_t> totalFontSelections(0);
+    std::mutex outputMutex; // serializes messages from the workers
 
-    Cairo::RefPtr<Cairo::PdfSurface> cs = Cairo::PdfSurface::create(cmdline.getOutputFile(), p.width, p.height);
-    if (!cs)
+    const auto batchStart = std::chrono::steady_clock::now();
+    runWorkerPool(jobs.size(), cmdline.getJobCount(), [&]()
     {
-        throw std::runtime_error("Can't create cairo PdfSurface");
-    }
+        // each thread has its own converter as these are not thread safe
+        auto converter = std::make_shared<Converter>(cmdline);
 
-    Margins m = cmdline.getPageMargins();
+        return [&, converter](size_t i)
+        {
+            const ConversionJob &job = jobs[i];
 
-    CairoTTY ctty(cs, p, m, preprocessor, std::move(translator));
+            const auto start = std::chrono::steady_clock::now();
+            try
+            {
+                const ConversionStats stats = converter->convert(job);
 
-    // Set the font
-    ctty.setFontName(cmdline.getFontFace());
-    ctty.setFontSize(cmdline.getFontSize());
-    ctty.home();
+                converted++;
+                totalBytes += stats.bytesRead;
+                totalFontSelections += stats.fontSelections;
+                if (cmdline.isStatsEnabled())
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    printStats(job.inputFile, stats, std::chrono::steady_clock::now() - start);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                // in batch mode, go on with the other files
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << job.inputFile << ": " << e.what() << '\n';
+                result = 1;
+            }
+        };
+    });
 
-    std::fstream f(cmdline.getInputFile(), std::fstream::in | std::fstream::binary);
-    if (!f.is_open())
+    if (cmdline.isBatch() && cmdline.isStatsEnabled())
     {
-        throw std::ios_base::failure("Unable to open file \"" + cmdline.getInputFile() + "\"");
+        ConversionStats total;
+        total.bytesRead = totalBytes;
+        total.fontSelections = totalFontSelections;
+
+        printStats("total (" + std::to_string(converted) + " of " + std::to_string(jobs.size()) + " files, "
+            + std::to_string(cmdline.getJobCount()) + " jobs)", total, std::chrono::steady_clock::now() - batchStart);
     }
 
-    char c;
-    while (!f.get(c).eof())
+    if (cmdline.getVerbosity() != Diagnostics::Verbosity::Quiet)
     {
-        ctty << static_cast<uint8_t>(c);
+        Diagnostics::printSummary(std::cerr, cmdline.getDiagnosticsFormat());
     }
 
-    return 0;
+    return result;
 }
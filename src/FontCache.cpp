@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FontCache.h"
+
+#include <cmath>
+#include <limits>
+
+FontCache::FontCache(Cairo::Antialias antialias):
+    m_antialias(antialias)
+{}
+
+Cairo::RefPtr<Cairo::FontFace> FontCache::getFace(const std::string &family, FontSlant slant, FontWeight weight)
+{
+    const TFaceKey key(family, slant, weight);
+
+    auto it = m_faces.find(key);
+    if (it == m_faces.end())
+    {
+        Cairo::FontSlant cairoSlant;
+        Cairo::FontWeight cairoWeight;
+
+        switch (weight)
+        {
+        case FontWeight::Bold:
+            cairoWeight = Cairo::FONT_WEIGHT_BOLD;
+            break;
+        default:
+            cairoWeight = Cairo::FONT_WEIGHT_NORMAL;
+            break;
+        }
+
+        switch (slant)
+        {
+        case FontSlant::Italic:
+            cairoSlant = Cairo::FONT_SLANT_ITALIC;
+            break;
+        default:
+            cairoSlant = Cairo::FONT_SLANT_NORMAL;
+            break;
+        }
+
+        it = m_faces.emplace(key, Cairo::ToyFontFace::create(family, cairoSlant, cairoWeight)).first;
+    }
+
+    return it->second;
+}
+
+FontCache::Font::Font()
+{
+    m_advances.fill(std::numeric_limits<double>::quiet_NaN());
+}
+
+double FontCache::Font::getAdvance(gunichar c)
+{
+    if (c < m_advances.size())
+    {
+        double &advance = m_advances[c];
+        if (std::isnan(advance))
+        {
+            advance = measureAdvance(c);
+        }
+
+        return advance;
+    }
+
+    auto it = m_otherAdvances.find(c);
+    if (it == m_otherAdvances.end())
+    {
+        it = m_otherAdvances.emplace(c, measureAdvance(c)).first;
+    }
+
+    return it->second;
+}
+
+double FontCache::Font::measureAdvance(gunichar c) const
+{
+    Cairo::TextExtents t;
+    scaledFont->get_text_extents(Glib::ustring(1, c).raw(), t);
+
+    return t.x_advance;
+}
+
+FontCache::Font &FontCache::getFont(const std::string &family, double size, FontSlant slant, FontWeight weight,
+    double stretchX, double stretchY)
+{
+    const TFontKey key(family, size, slant, weight, stretchX, stretchY);
+
+    auto it = m_fonts.find(key);
+    if (it == m_fonts.end())
+    {
+        Font font;
+        font.face = getFace(family, slant, weight);
+        font.scaledFont = Cairo::ScaledFont::create(font.face, Cairo::scaling_matrix(size * stretchX, size * stretchY),
+            Cairo::identity_matrix(), getFontOptions(m_antialias));
+        font.scaledFont->get_extents(font.extents);
+
+        it = m_fonts.emplace(key, font).first;
+    }
+
+    return it->second;
+}
+
+Cairo::FontOptions FontCache::getFontOptions(Cairo::Antialias antialias)
+{
+    Cairo::FontOptions options;
+    options.set_hint_style(Cairo::HINT_STYLE_NONE);
+    options.set_hint_metrics(Cairo::HINT_METRICS_OFF);
+    options.set_antialias(antialias);
+
+    return options;
+}
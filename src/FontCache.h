@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FONT_CACHE_H_
+#define FONT_CACHE_H_
+
+#include <array>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include <glibmm.h>
+#include <cairomm/cairomm.h>
+
+#include "DisplayList.h"
+
+/**
+ * \brief Cache of resolved fonts.
+ *
+ * Cairo resolves a font face (via fontconfig) when it is first used and
+ * forgets the result once the last reference is dropped. Keeping the faces
+ * here means they are resolved only once even when several documents are
+ * converted one after another.
+ *
+ * For each face, size and stretch a ready Cairo::ScaledFont and its extents
+ * are kept too, so switching between fonts costs no lookups in Cairo.
+ *
+ * Cairo::RefPtr is not thread safe, so a FontCache must not be shared
+ * between threads.
+ */
+class FontCache
+{
+public:
+    /** \brief A font face resolved for a particular size. */
+    struct Font
+    {
+        Font();
+
+        /**
+         * Get the horizontal advance of a character.
+         *
+         * The character is measured only the first time, later calls are
+         * just a lookup.
+         */
+        double getAdvance(gunichar c);
+
+        Cairo::RefPtr<Cairo::FontFace> face;
+        Cairo::RefPtr<Cairo::ScaledFont> scaledFont;
+        Cairo::FontExtents extents;
+
+    private:
+        /** \brief Advances of the first 256 code points, NaN if not measured yet. */
+        std::array<double, 256> m_advances;
+
+        /** \brief Advances of the other code points. */
+        std::unordered_map<gunichar, double> m_otherAdvances;
+
+        double measureAdvance(gunichar c) const;
+    };
+
+    /**
+     * The antialiasing only matters when drawing on an image surface, e.g.
+     * ANTIALIAS_NONE for crisp 1-bit images. It doesn't change the layout.
+     */
+    explicit FontCache(Cairo::Antialias antialias = Cairo::ANTIALIAS_GRAY);
+
+    Cairo::RefPtr<Cairo::FontFace> getFace(const std::string &family, FontSlant slant, FontWeight weight);
+
+    /**
+     * Get the font of the given size.
+     *
+     * The font is stretched horizontally by stretchX and vertically by
+     * stretchY, the stretch is part of its font matrix. The returned
+     * reference stays valid as long as the FontCache exists.
+     */
+    Font &getFont(const std::string &family, double size, FontSlant slant, FontWeight weight,
+        double stretchX, double stretchY);
+
+    /**
+     * Font options used for all the scaled fonts.
+     *
+     * These are the options used by the Cairo PDF surface: no hinting, and
+     * so the layout doesn't depend on where the text is drawn.
+     */
+    static Cairo::FontOptions getFontOptions(Cairo::Antialias antialias = Cairo::ANTIALIAS_GRAY);
+
+private:
+    typedef std::tuple<std::string, FontSlant, FontWeight> TFaceKey;
+    typedef std::tuple<std::string, double, FontSlant, FontWeight, double, double> TFontKey;
+
+    std::map<TFaceKey, Cairo::RefPtr<Cairo::FontFace>> m_faces;
+    std::map<TFontKey, Font> m_fonts;
+    Cairo::Antialias m_antialias;
+};
+
+#endif // FONT_CACHE_H_
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InputFile.h"
+
+#include <system_error>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+InputFile::InputFile(const std::string &fileName):
+    m_fileName(fileName),
+    m_isStdin(fileName == "-"),
+    m_fd(m_isStdin ? STDIN_FILENO : open(fileName.c_str(), O_RDONLY)),
+    m_map(nullptr),
+    m_mapSize(0),
+    m_mapConsumed(false),
+    m_bytesRead(0)
+{
+    if (m_fd == -1)
+    {
+        const int e = errno;
+        throw std::system_error(e, std::generic_category(), "can't open " + m_fileName);
+    }
+
+    if (!mapFile())
+    {
+        m_buffer.resize(BLOCK_SIZE);
+    }
+}
+
+InputFile::~InputFile()
+{
+    if (m_map)
+    {
+        munmap(const_cast<uint8_t*>(m_map), m_mapSize);
+    }
+
+    if (!m_isStdin)
+    {
+        close(m_fd);
+    }
+}
+
+bool InputFile::mapFile()
+{
+    struct stat st;
+    if (fstat(m_fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        return false;
+    }
+
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // the input is consumed strictly front to back
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    m_map = static_cast<const uint8_t*>(p);
+    m_mapSize = st.st_size;
+    return true;
+}
+
+bool InputFile::read(const uint8_t *&data, size_t &size)
+{
+    if (m_map)
+    {
+        if (m_mapConsumed)
+        {
+            return false;
+        }
+
+        data = m_map;
+        size = m_mapSize;
+        m_mapConsumed = true;
+        m_bytesRead += size;
+        return true;
+    }
+
+    while (true)
+    {
+        const ssize_t r = ::read(m_fd, m_buffer.data(), m_buffer.size());
+        if (r == -1)
+        {
+            const int e = errno;
+            if (e == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(e, std::generic_category(), "can't read " + m_fileName);
+        }
+
+        if (r == 0)
+        {
+            return false;
+        }
+
+        data = m_buffer.data();
+        size = static_cast<size_t>(r);
+        m_bytesRead += size;
+        return true;
+    }
+}
+
+void InputFile::readAll(const uint8_t *&data, size_t &size)
+{
+    if (m_map)
+    {
+        if (!read(data, size))
+        {
+            size = 0;
+        }
+        return;
+    }
+
+    std::vector<uint8_t> contents;
+    const uint8_t *block;
+    size_t blockSize;
+    while (read(block, blockSize))
+    {
+        contents.insert(contents.end(), block, block + blockSize);
+    }
+
+    m_buffer = std::move(contents);
+    data = m_buffer.data();
+    size = m_buffer.size();
+}
+
+uint64_t InputFile::getBytesRead() const
+{
+    return m_bytesRead;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INPUT_FILE_H_
+#define INPUT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Bulk reader for the input (spool) file.
+ *
+ * Regular files are memory-mapped and handed out as a single block. If the
+ * file can't be mapped, it is read in blocks of BLOCK_SIZE bytes instead.
+ *
+ * The file name "-" stands for the standard input.
+ */
+class InputFile
+{
+public:
+    explicit InputFile(const std::string &fileName);
+    ~InputFile();
+
+    InputFile(const InputFile &) = delete;
+    InputFile &operator=(const InputFile &) = delete;
+
+    /**
+     * Get the next block of input.
+     *
+     * The returned data stay valid until the next call to read() or until
+     * the InputFile is destroyed. Returns false when the input is exhausted.
+     */
+    bool read(const uint8_t *&data, size_t &size);
+
+    /**
+     * Get the whole (remaining) input as one block.
+     *
+     * Mapped files are returned as they are, other input is read into memory.
+     * The returned data stay valid until the InputFile is destroyed.
+     */
+    void readAll(const uint8_t *&data, size_t &size);
+
+    /** \brief Total number of bytes handed out by read() so far. */
+    uint64_t getBytesRead() const;
+
+    /** \brief Size of the blocks used when the input can't be mapped. */
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+private:
+    const std::string m_fileName;
+    const bool m_isStdin;
+    int m_fd;
+
+    const uint8_t *m_map;
+    size_t m_mapSize;
+    bool m_mapConsumed;
+
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_bytesRead;
+
+    bool mapFile();
+};
+
+#endif // INPUT_FILE_H_
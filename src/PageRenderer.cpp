@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PageRenderer.h"
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "CcittFax.h"
+#include "ReversedBytes.h"
+
+namespace
+{
+    /** \brief FNV-1a hash of the bitmap, including its size. */
+    uint64_t hashBitmap(uint32_t width, uint32_t height, const uint8_t *rows, size_t size, uint64_t hash)
+    {
+        constexpr uint64_t PRIME = 0x100000001b3ull;
+
+        for (uint32_t value: { width, height })
+        {
+            for (unsigned i = 0; i < 4; i++, value >>= 8)
+                hash = (hash ^ (value & 0xff)) * PRIME;
+        }
+
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ rows[i]) * PRIME;
+
+        return hash;
+    }
+
+    /** \brief Size of the data compressed the way Cairo compresses PDF streams. */
+    size_t getDeflatedSize(const uint8_t *data, size_t size)
+    {
+        uLongf deflatedSize = compressBound(size);
+        std::vector<uint8_t> deflated(deflatedSize);
+        if (compress2(deflated.data(), &deflatedSize, data, size, Z_DEFAULT_COMPRESSION) != Z_OK)
+            throw std::runtime_error("Can't compress a bitmap");
+
+        return deflatedSize;
+    }
+
+    void deleteMimeData(void *data)
+    {
+        delete static_cast<std::vector<uint8_t>*>(data);
+    }
+
+    /** \brief Attach data to the surface, to be used by the output backend instead of the pixels. */
+    void setMimeData(const Cairo::RefPtr<Cairo::Surface> &surface, const char *mimeType, std::vector<uint8_t> data)
+    {
+        auto *owned = new std::vector<uint8_t>(std::move(data));
+        cairo_surface_set_mime_data(surface->cobj(), mimeType, owned->data(), owned->size(), deleteMimeData, owned);
+    }
+
+    void setMimeData(const Cairo::RefPtr<Cairo::Surface> &surface, const char *mimeType, const std::string &data)
+    {
+        setMimeData(surface, mimeType, std::vector<uint8_t>(data.begin(), data.end()));
+    }
+}
+
+PageRenderer::PageRenderer(Cairo::RefPtr<Cairo::Surface> surface, std::shared_ptr<FontCache> fontCache, bool showPages,
+    GraphicsCompression graphicsCompression):
+    m_surface(std::move(surface)),
+    m_context(Cairo::Context::create(m_surface)),
+    m_fontCache(std::move(fontCache)),
+    m_showPages(showPages),
+    m_graphicsCompression(graphicsCompression),
+    m_bitmapCacheSize(0)
+{}
+
+PageRenderer::~PageRenderer()
+{
+    m_context.clear();
+}
+
+void PageRenderer::addPage(const PageDisplayList &page)
+{
+    render(page);
+
+    if (m_showPages)
+    {
+        m_context->show_page();
+    }
+}
+
+void PageRenderer::render(const PageDisplayList &page)
+{
+    const std::vector<TextStyle> &styles = page.getStyles();
+    const std::string &text = page.getText();
+
+    std::optional<uint32_t> currentStyle;
+    Cairo::RefPtr<Cairo::ScaledFont> scaledFont;
+    for (const TextRun &run: page.getTextRuns())
+    {
+        const TextStyle &style = styles[run.style];
+
+        if (run.style != currentStyle)
+        {
+            // the stretch is part of the font, so the context is never scaled
+            scaledFont = m_fontCache->getFont(style.fontName, style.fontSize, style.fontSlant,
+                style.fontWeight, style.stretchX, style.stretchY).scaledFont;
+            m_context->set_scaled_font(scaledFont);
+            currentStyle = run.style;
+        }
+
+        const std::string runText = text.substr(run.textOffset, run.textLength);
+        if (run.cellWidth > 0.0)
+        {
+            showFixedPitch(scaledFont, run, runText);
+        }
+        else
+        {
+            m_context->move_to(run.x, run.y);
+            m_context->show_text(runText);
+        }
+    }
+
+    for (const Bitmap &bitmap: page.getBitmaps())
+    {
+        showBitmap(bitmap, page.getBitmapData().data() + bitmap.dataOffset);
+    }
+
+    for (const Rule &rule: page.getRules())
+    {
+        m_context->set_line_width(rule.width);
+        m_context->move_to(rule.x1, rule.y);
+        m_context->line_to(rule.x2, rule.y);
+        m_context->stroke();
+    }
+}
+
+void PageRenderer::showFixedPitch(const Cairo::RefPtr<Cairo::ScaledFont> &scaledFont, const TextRun &run,
+    const std::string &text)
+{
+    std::vector<Cairo::Glyph> glyphs;
+    std::vector<Cairo::TextCluster> clusters;
+    Cairo::TextClusterFlags flags;
+    scaledFont->text_to_glyphs(run.x, run.y, text, glyphs, clusters, flags);
+
+    // put each character into its cell; the clusters map glyphs to characters
+    size_t glyph = 0;
+    double x = run.x;
+    for (const Cairo::TextCluster &cluster: clusters)
+    {
+        if (cluster.num_glyphs > 0)
+        {
+            const double offset = x - glyphs[glyph].x;
+            for (int i = 0; i < cluster.num_glyphs; i++, glyph++)
+            {
+                glyphs[glyph].x += offset;
+            }
+        }
+
+        x += run.cellWidth;
+    }
+
+    m_context->show_glyphs(glyphs);
+}
+
+void PageRenderer::showBitmap(const Bitmap &bitmap, const uint8_t *rows)
+{
+    // keep the dots sharp when scaling the image up
+    auto pattern = Cairo::SurfacePattern::create(getBitmapSurface(bitmap, rows));
+    pattern->set_filter(Cairo::FILTER_NEAREST);
+
+    m_context->save();
+    m_context->translate(bitmap.x, bitmap.y);
+    m_context->scale(bitmap.dotWidth, bitmap.dotHeight);
+    m_context->mask(pattern);
+    m_context->restore();
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> PageRenderer::getBitmapSurface(const Bitmap &bitmap, const uint8_t *rows)
+{
+    const size_t rowSize = (bitmap.width + 7) / 8;
+    const size_t size = rowSize * bitmap.height;
+
+    const uint64_t hash = hashBitmap(bitmap.width, bitmap.height, rows, size, 0xcbf29ce484222325ull);
+    const auto range = m_bitmapCache.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const CachedBitmap &cached = it->second;
+        if (cached.width == bitmap.width && cached.height == bitmap.height
+            && std::equal(cached.rows.begin(), cached.rows.end(), rows))
+        {
+            return cached.surface;
+        }
+    }
+
+    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_A1, bitmap.width, bitmap.height);
+    surface->flush();
+
+    // cairo keeps A1 pixels in 32-bit words, the first one in the least significant bit on little endian
+    const int stride = surface->get_stride();
+    unsigned char *data = surface->get_data();
+    const uint8_t *src = rows;
+    for (uint32_t row = 0; row < bitmap.height; row++, src += rowSize, data += stride)
+    {
+        for (size_t i = 0; i < rowSize; i++)
+        {
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+            data[i] = REVERSED_BYTES[src[i]];
+#else
+            data[i] = src[i];
+#endif
+        }
+    }
+    surface->mark_dirty();
+
+    /*
+     * Cairo writes surfaces with the same unique ID once per document. The ID
+     * is made of two hashes with different seeds, so that it also works for
+     * other renderers (and their caches) writing into the same document.
+     */
+    std::ostringstream id;
+    id << "dotprint-bitmap-" << std::hex << hash << '-'
+        << hashBitmap(bitmap.width, bitmap.height, rows, size, 0x84222325cbf29ce4ull);
+    setMimeData(surface, CAIRO_MIME_TYPE_UNIQUE_ID, id.str());
+
+    /*
+     * The PDF backend writes the CCITT data as is, instead of deflating the
+     * pixels. G4 wins on irregular shapes like signatures, but loses on
+     * dithering and on rows repeating in a short band, so it's only used when
+     * it's smaller.
+     */
+    if (m_graphicsCompression == GraphicsCompression::CcittG4)
+    {
+        std::vector<uint8_t> encoded = encodeCcittG4(rows, bitmap.width, bitmap.height, rowSize);
+        if (encoded.size() < getDeflatedSize(rows, size))
+        {
+            std::ostringstream params;
+            params << "Columns=" << bitmap.width << " Rows=" << bitmap.height << " K=-1 BlackIs1=true";
+
+            setMimeData(surface, CAIRO_MIME_TYPE_CCITT_FAX, std::move(encoded));
+            setMimeData(surface, CAIRO_MIME_TYPE_CCITT_FAX_PARAMS, params.str());
+        }
+    }
+
+    // don't let the cache grow without bounds on pages full of different graphics
+    if (m_bitmapCacheSize + size > MAX_BITMAP_CACHE_SIZE)
+    {
+        m_bitmapCache.clear();
+        m_bitmapCacheSize = 0;
+    }
+
+    m_bitmapCache.insert({hash, {bitmap.width, bitmap.height, std::vector<uint8_t>(rows, rows + size), surface}});
+    m_bitmapCacheSize += size;
+
+    return surface;
+}
+
+void PageRenderer::setAntialias(Cairo::Antialias antialias)
+{
+    m_context->set_antialias(antialias);
+}
+
+GraphicsCompression PageRenderer::lookupGraphicsCompression(const std::string &name)
+{
+    if (name == "flate")
+        return GraphicsCompression::Flate;
+    if (name == "ccitt")
+        return GraphicsCompression::CcittG4;
+
+    throw std::runtime_error("Unknown graphics compression: " + name);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAGE_RENDERER_H_
+#define PAGE_RENDERER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cairomm/cairomm.h>
+
+#include "DisplayList.h"
+#include "FontCache.h"
+
+/** \brief How the bitmaps are compressed in the output. */
+enum class GraphicsCompression
+{
+    /** \brief Left to Cairo, i.e. Flate for PDF. */
+    Flate,
+
+    /** \brief CCITT Group 4, made for 1-bit images, for the bitmaps it makes smaller than Flate. */
+    CcittG4
+};
+
+/** \brief Draws page display lists on a Cairo surface. */
+class PageRenderer: public IPageSink
+{
+public:
+    /**
+     * If showPages is set, each page added via addPage() is shown (i.e. a new
+     * page is started on the surface after it).
+     */
+    PageRenderer(Cairo::RefPtr<Cairo::Surface> surface, std::shared_ptr<FontCache> fontCache, bool showPages = true,
+        GraphicsCompression graphicsCompression = GraphicsCompression::Flate);
+    virtual ~PageRenderer();
+
+    virtual void addPage(const PageDisplayList &page) override;
+
+    /** \brief Draw the page on the current page of the surface. */
+    void render(const PageDisplayList &page);
+
+    /** \brief Set the antialiasing of rules. Text uses the antialiasing of the font cache. */
+    void setAntialias(Cairo::Antialias antialias);
+
+    /** \brief Get the compression by its command line name. Throws on unknown names. */
+    static GraphicsCompression lookupGraphicsCompression(const std::string &name);
+
+private:
+    /** \brief Draw a fixed-pitch run, placing each character in its cell. */
+    void showFixedPitch(const Cairo::RefPtr<Cairo::ScaledFont> &scaledFont, const TextRun &run,
+        const std::string &text);
+
+    /** \brief Draw a bitmap as an image mask, so that it stays 1-bit in the output. */
+    void showBitmap(const Bitmap &bitmap, const uint8_t *rows);
+
+    /**
+     * Get the mask surface of a bitmap.
+     *
+     * Identical bitmaps (e.g. a logo printed on each page) get the same
+     * surface, tagged with an ID derived from the content. Cairo then puts
+     * the image into the PDF just once, even if it's drawn by several
+     * renderers.
+     */
+    Cairo::RefPtr<Cairo::ImageSurface> getBitmapSurface(const Bitmap &bitmap, const uint8_t *rows);
+
+    Cairo::RefPtr<Cairo::Surface> m_surface;
+    Cairo::RefPtr<Cairo::Context> m_context;
+    std::shared_ptr<FontCache> m_fontCache;
+    bool m_showPages;
+    GraphicsCompression m_graphicsCompression;
+
+    /** \brief A surface created by getBitmapSurface() along with the bitmap it was made from. */
+    struct CachedBitmap
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> rows;
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+    };
+
+    /** \brief Surfaces of the bitmaps drawn so far, by the hash of their content. */
+    std::unordered_multimap<uint64_t, CachedBitmap> m_bitmapCache;
+    size_t m_bitmapCacheSize;
+
+    /** \brief When the cached bitmaps take more bytes than this, the cache starts over. */
+    static constexpr size_t MAX_BITMAP_CACHE_SIZE = 16 << 20;
+};
+
+#endif // PAGE_RENDERER_H_
@@ -26,18 +26,20 @@
 
 namespace
 {
-    SimplePreprocessor Simple;
-    CRLFPreprocessor CRLF;
-    EpsonPreprocessor Epson;
+    template<typename T>
+    std::unique_ptr<ICharPreprocessor> create()
+    {
+        return std::make_unique<T>();
+    }
 
-    const std::map<std::string, ICharPreprocessor*> PREPROCESSORS =
+    const std::map<std::string, PreprocessorFactory::TCreator> PREPROCESSORS =
     {
-        { "simple", &Simple },
-        { "crlf", &CRLF },
-        { "epson", &Epson }
+        { "simple", &create<SimplePreprocessor> },
+        { "crlf", &create<CRLFPreprocessor> },
+        { "epson", &create<EpsonPreprocessor> }
     };
 
-    ICharPreprocessor* DEFAULT_PREPROCESSOR = &Epson;
+    const PreprocessorFactory::TCreator DEFAULT_PREPROCESSOR = &create<EpsonPreprocessor>;
 }
 
 void PreprocessorFactory::print(std::ostream &s)
@@ -51,13 +53,13 @@ void PreprocessorFactory::print(std::ostream &s)
     }
 }
 
-ICharPreprocessor* PreprocessorFactory::lookup(const std::string& name)
+PreprocessorFactory::TCreator PreprocessorFactory::lookup(const std::string& name)
 {
     const auto it = PREPROCESSORS.find(name);
     return it != PREPROCESSORS.end() ? it->second : nullptr;
 }
 
-ICharPreprocessor* PreprocessorFactory::getDefault()
+PreprocessorFactory::TCreator PreprocessorFactory::getDefault()
 {
     return DEFAULT_PREPROCESSOR;
 }
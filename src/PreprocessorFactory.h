@@ -21,16 +21,25 @@
 #define PREPROCESSOR_FACTORY_H_
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "CairoTTY.h"
 
+/**
+ * \brief Looks up preprocessors by name.
+ *
+ * Preprocessors keep parsing state, so each document needs its own instance.
+ * The factory therefore hands out functions that create new instances.
+ */
 class PreprocessorFactory
 {
 public:
+    typedef std::unique_ptr<ICharPreprocessor> (*TCreator)();
+
     static void print(std::ostream &s);
-    static ICharPreprocessor* lookup(const std::string &name);
-    static ICharPreprocessor* getDefault();
+    static TCreator lookup(const std::string &name);
+    static TCreator getDefault();
 
     PreprocessorFactory() = delete;
 };
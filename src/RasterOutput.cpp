@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RasterOutput.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include "CcittFax.h"
+#include "Converter.h"
+#include "PageRenderer.h"
+#include "ReversedBytes.h"
+
+namespace
+{
+    const double POINTS_PER_INCH = 72.0;
+
+    /** \brief TIFF field types. */
+    enum TiffType: uint16_t
+    {
+        TIFF_SHORT = 3,
+        TIFF_LONG = 4,
+        TIFF_RATIONAL = 5
+    };
+
+    void put16(std::vector<uint8_t> &out, uint16_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void put32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        put16(out, static_cast<uint16_t>(value));
+        put16(out, static_cast<uint16_t>(value >> 16));
+    }
+
+    /** \brief Write an IFD entry. Short values are stored in the first half of the value field. */
+    void putEntry(std::vector<uint8_t> &out, uint16_t tag, TiffType type, uint32_t count, uint32_t value)
+    {
+        put16(out, tag);
+        put16(out, type);
+        put32(out, count);
+        put32(out, value);
+    }
+
+    /** \brief Append a big endian value, as used by PNG. */
+    void putBigEndian32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void putPngChunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data)
+    {
+        putBigEndian32(png, static_cast<uint32_t>(data.size()));
+
+        // the CRC covers the type and the data
+        const size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        putBigEndian32(png, static_cast<uint32_t>(crc32(0, png.data() + start, static_cast<uInt>(png.size() - start))));
+    }
+
+    /** \brief Encode an 8-bit grayscale PNG. Cairo can only write color PNGs. */
+    std::vector<uint8_t> encodeGrayPng(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height)
+    {
+        // each row starts with its filter type, 0 is none
+        std::vector<uint8_t> filtered;
+        filtered.reserve((width + 1) * height);
+        for (uint32_t row = 0; row < height; row++)
+        {
+            filtered.push_back(0);
+            filtered.insert(filtered.end(), pixels.begin() + row * width, pixels.begin() + (row + 1) * width);
+        }
+
+        uLongf deflatedSize = compressBound(filtered.size());
+        std::vector<uint8_t> deflated(deflatedSize);
+        if (compress2(deflated.data(), &deflatedSize, filtered.data(), filtered.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+            throw std::runtime_error("Can't compress the PNG image");
+        deflated.resize(deflatedSize);
+
+        std::vector<uint8_t> header;
+        putBigEndian32(header, width);
+        putBigEndian32(header, height);
+        header.insert(header.end(), {
+            8, // bit depth
+            0, // color type: grayscale
+            0, // compression: deflate
+            0, // filter method
+            0 // no interlace
+        });
+
+        std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        putPngChunk(png, "IHDR", header);
+        putPngChunk(png, "IDAT", deflated);
+        putPngChunk(png, "IEND", {});
+
+        return png;
+    }
+
+    void writeFile(const std::string &name, const std::vector<uint8_t> &data)
+    {
+        if (name == Converter::STD_STREAM_NAME)
+        {
+            BufferedWriter writer(STDOUT_FILENO);
+            writer.write(data.data(), data.size());
+            writer.flush();
+            return;
+        }
+
+        std::ofstream f(name, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!f)
+            throw std::runtime_error("Can't write " + name);
+    }
+}
+
+RasterOutput::RasterOutput(const RasterOptions &options, const PageSize &pageSize):
+    m_options(options),
+    m_width(static_cast<int>(std::lround(pageSize.width / POINTS_PER_INCH * options.dpi))),
+    m_height(static_cast<int>(std::lround(pageSize.height / POINTS_PER_INCH * options.dpi))),
+    m_pageCount(0),
+    m_offset(0)
+{
+    if (m_width <= 0 || m_height <= 0)
+        throw std::runtime_error("The page is too small for the raster resolution");
+}
+
+std::shared_ptr<FontCache> RasterOutput::createFontCache() const
+{
+    return std::make_shared<FontCache>(m_options.antialias ? Cairo::ANTIALIAS_GRAY : Cairo::ANTIALIAS_NONE);
+}
+
+std::vector<uint8_t> RasterOutput::encodePage(const PageDisplayList &page,
+    const std::shared_ptr<FontCache> &fontCache) const
+{
+    std::vector<uint8_t> encoded;
+
+    switch (m_options.format)
+    {
+    case RasterFormat::Png:
+        encoded = encodeGrayPng(renderGray(page, fontCache), m_width, m_height);
+        break;
+
+    case RasterFormat::Pbm:
+    {
+        const std::string header = "P4\n" + std::to_string(m_width) + ' ' + std::to_string(m_height) + '\n';
+        const std::vector<uint8_t> rows = renderBitmap(page, fontCache);
+
+        encoded.assign(header.begin(), header.end());
+        encoded.insert(encoded.end(), rows.begin(), rows.end());
+        break;
+    }
+
+    case RasterFormat::Tiff:
+        encoded = encodeCcittG4(renderBitmap(page, fontCache).data(), m_width, m_height, (m_width + 7) / 8);
+        break;
+    }
+
+    return encoded;
+}
+
+void RasterOutput::open(const std::string &outputFile)
+{
+    m_outputFile = outputFile;
+
+    // PNG pages are written to files of their own
+    if (m_options.format == RasterFormat::Png)
+        return;
+
+    if (outputFile == Converter::STD_STREAM_NAME)
+    {
+        m_stdoutWriter.emplace(STDOUT_FILENO);
+        return;
+    }
+
+    m_file.open(outputFile, std::ios::binary);
+    if (!m_file)
+        throw std::runtime_error("Can't write " + outputFile);
+}
+
+void RasterOutput::writePage(std::vector<uint8_t> page)
+{
+    if (m_heldPage)
+        writeHeldPage(false);
+
+    m_heldPage = std::move(page);
+}
+
+void RasterOutput::close()
+{
+    if (m_heldPage)
+        writeHeldPage(true);
+
+    if (m_stdoutWriter)
+    {
+        m_stdoutWriter->flush();
+        m_stdoutWriter.reset();
+    }
+    else if (m_file.is_open())
+    {
+        m_file.close();
+        if (!m_file)
+            throw std::runtime_error("Can't write " + m_outputFile);
+    }
+}
+
+void RasterOutput::writeHeldPage(bool last)
+{
+    const std::vector<uint8_t> page = std::move(*m_heldPage);
+    m_heldPage.reset();
+
+    switch (m_options.format)
+    {
+    case RasterFormat::Png:
+        if (last && m_pageCount == 0)
+        {
+            writeFile(m_outputFile, page);
+            break;
+        }
+
+        if (m_outputFile == Converter::STD_STREAM_NAME)
+            throw std::runtime_error("Several PNG pages can't be written to stdout");
+
+        {
+            const std::filesystem::path path(m_outputFile);
+            const std::filesystem::path pagePath = path.parent_path()
+                / (path.stem().string() + '-' + std::to_string(m_pageCount + 1) + path.extension().string());
+
+            writeFile(pagePath.string(), page);
+        }
+        break;
+
+    case RasterFormat::Pbm:
+        // a PBM file may hold several images one after another
+        writeData(page);
+        break;
+
+    case RasterFormat::Tiff:
+        writeTiffPage(page, last);
+        break;
+    }
+
+    m_pageCount++;
+}
+
+void RasterOutput::writeData(const std::vector<uint8_t> &data)
+{
+    if (m_stdoutWriter)
+    {
+        m_stdoutWriter->write(data.data(), static_cast<unsigned>(data.size()));
+    }
+    else
+    {
+        m_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!m_file)
+            throw std::runtime_error("Can't write " + m_outputFile);
+    }
+
+    m_offset += data.size();
+}
+
+RasterFormat RasterOutput::lookupFormat(const std::string &name)
+{
+    if (name == "png")
+        return RasterFormat::Png;
+    if (name == "pbm")
+        return RasterFormat::Pbm;
+    if (name == "tiff")
+        return RasterFormat::Tiff;
+
+    throw std::runtime_error("Unknown raster format: " + name);
+}
+
+const char *RasterOutput::getExtension(RasterFormat format)
+{
+    switch (format)
+    {
+    case RasterFormat::Png:
+        return ".png";
+    case RasterFormat::Pbm:
+        return ".pbm";
+    case RasterFormat::Tiff:
+        return ".tiff";
+    }
+
+    return "";
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> RasterOutput::render(const PageDisplayList &page,
+    const std::shared_ptr<FontCache> &fontCache, Cairo::Format format) const
+{
+    // everything drawn is black, so the surface only needs the coverage; the rest stays white
+    auto surface = Cairo::ImageSurface::create(format, m_width, m_height);
+    surface->set_device_scale(m_options.dpi / POINTS_PER_INCH, m_options.dpi / POINTS_PER_INCH);
+
+    {
+        PageRenderer renderer(surface, fontCache, false);
+        if (!m_options.antialias)
+            renderer.setAntialias(Cairo::ANTIALIAS_NONE);
+        renderer.render(page);
+    }
+
+    surface->flush();
+    return surface;
+}
+
+std::vector<uint8_t> RasterOutput::renderBitmap(const PageDisplayList &page,
+    const std::shared_ptr<FontCache> &fontCache) const
+{
+    auto surface = render(page, fontCache, Cairo::FORMAT_A1);
+
+    const size_t rowSize = (m_width + 7) / 8;
+    const uint8_t lastByteMask = static_cast<uint8_t>(0xff00 >> ((m_width - 1) % 8 + 1));
+
+    std::vector<uint8_t> rows(rowSize * m_height);
+    const unsigned char *data = surface->get_data();
+    for (int row = 0; row < m_height; row++, data += surface->get_stride())
+    {
+        uint8_t *out = rows.data() + row * rowSize;
+        for (size_t i = 0; i < rowSize; i++)
+        {
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+            out[i] = REVERSED_BYTES[data[i]];
+#else
+            out[i] = data[i];
+#endif
+        }
+
+        out[rowSize - 1] &= lastByteMask;
+    }
+
+    return rows;
+}
+
+std::vector<uint8_t> RasterOutput::renderGray(const PageDisplayList &page,
+    const std::shared_ptr<FontCache> &fontCache) const
+{
+    auto surface = render(page, fontCache, Cairo::FORMAT_A8);
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(m_width) * m_height);
+    const unsigned char *data = surface->get_data();
+    for (int row = 0; row < m_height; row++, data += surface->get_stride())
+    {
+        uint8_t *out = pixels.data() + static_cast<size_t>(row) * m_width;
+        for (int i = 0; i < m_width; i++)
+            out[i] = 255 - data[i];
+    }
+
+    return pixels;
+}
+
+void RasterOutput::writeTiffPage(const std::vector<uint8_t> &strip, bool last)
+{
+    const uint16_t ENTRY_COUNT = 15;
+    const uint32_t IFD_SIZE = 2 + ENTRY_COUNT * 12 + 4;
+    const uint32_t RESOLUTION_DENOMINATOR = 100;
+    const uint32_t resolution = static_cast<uint32_t>(std::lround(m_options.dpi * RESOLUTION_DENOMINATOR));
+
+    std::vector<uint8_t> tiff;
+    if (m_pageCount == 0)
+    {
+        // little endian header pointing to the first IFD
+        tiff = { 'I', 'I', 42, 0 };
+        put32(tiff, 8);
+    }
+
+    // the page is its IFD, then the resolution values and the strip
+    const uint32_t ifdOffset = static_cast<uint32_t>(m_offset + tiff.size());
+    const uint32_t resolutionOffset = ifdOffset + IFD_SIZE;
+    const uint32_t stripOffset = resolutionOffset + 16;
+
+    // IFDs must start on a word boundary
+    const uint32_t pageEnd = stripOffset + static_cast<uint32_t>((strip.size() + 1) & ~size_t(1));
+    const uint32_t nextIfdOffset = last ? 0 : pageEnd;
+
+    put16(tiff, ENTRY_COUNT);
+    putEntry(tiff, 254, TIFF_LONG, 1, 2); // NewSubfileType: a page of a multi-page image
+    putEntry(tiff, 256, TIFF_LONG, 1, m_width); // ImageWidth
+    putEntry(tiff, 257, TIFF_LONG, 1, m_height); // ImageLength
+    putEntry(tiff, 258, TIFF_SHORT, 1, 1); // BitsPerSample
+    putEntry(tiff, 259, TIFF_SHORT, 1, 4); // Compression: CCITT T.6
+    putEntry(tiff, 262, TIFF_SHORT, 1, 0); // PhotometricInterpretation: WhiteIsZero
+    putEntry(tiff, 273, TIFF_LONG, 1, stripOffset); // StripOffsets
+    putEntry(tiff, 277, TIFF_SHORT, 1, 1); // SamplesPerPixel
+    putEntry(tiff, 278, TIFF_LONG, 1, m_height); // RowsPerStrip
+    putEntry(tiff, 279, TIFF_LONG, 1, static_cast<uint32_t>(strip.size())); // StripByteCounts
+    putEntry(tiff, 282, TIFF_RATIONAL, 1, resolutionOffset); // XResolution
+    putEntry(tiff, 283, TIFF_RATIONAL, 1, resolutionOffset + 8); // YResolution
+    putEntry(tiff, 293, TIFF_LONG, 1, 0); // T6Options
+    putEntry(tiff, 296, TIFF_SHORT, 1, 2); // ResolutionUnit: inch
+    // PageNumber: the page and the page count, which isn't known yet (0) as the pages are streamed
+    putEntry(tiff, 297, TIFF_SHORT, 2, static_cast<uint32_t>(m_pageCount));
+    put32(tiff, nextIfdOffset);
+
+    for (int i = 0; i < 2; i++)
+    {
+        put32(tiff, resolution);
+        put32(tiff, RESOLUTION_DENOMINATOR);
+    }
+
+    tiff.insert(tiff.end(), strip.begin(), strip.end());
+    tiff.resize(pageEnd - m_offset);
+
+    writeData(tiff);
+}
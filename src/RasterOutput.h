@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RASTER_OUTPUT_H_
+#define RASTER_OUTPUT_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "BufferedWriter.h"
+#include "CairoTTY.h"
+#include "DisplayList.h"
+#include "FontCache.h"
+
+/** \brief Image formats of the raster output. */
+enum class RasterFormat
+{
+    /** \brief 8-bit grayscale page images, one file per page. */
+    Png,
+
+    /** \brief 1-bit page images, all of them in one file. */
+    Pbm,
+
+    /** \brief 1-bit multi-page TIFF, compressed with CCITT Group 4 like a fax. */
+    Tiff
+};
+
+/** \brief Settings of the raster output. */
+struct RasterOptions
+{
+    RasterFormat format;
+
+    /** \brief Resolution of the images, in dots per inch. */
+    double dpi;
+
+    /** \brief If not set, text and rules are drawn with sharp edges. */
+    bool antialias;
+};
+
+/**
+ * \brief Renders pages into images instead of a PDF.
+ *
+ * Encoding a page doesn't touch any shared state, so pages can be encoded on
+ * several threads at once, each with its own FontCache (see
+ * createFontCache()). The encoded pages are then written out in order, by
+ * one thread, between open() and close().
+ */
+class RasterOutput
+{
+public:
+    RasterOutput(const RasterOptions &options, const PageSize &pageSize);
+
+    /** \brief Create a font cache for encodePage(), with the antialiasing of the options. */
+    std::shared_ptr<FontCache> createFontCache() const;
+
+    /** \brief Draw the page and encode the image, in the format of the options. */
+    std::vector<uint8_t> encodePage(const PageDisplayList &page, const std::shared_ptr<FontCache> &fontCache) const;
+
+    /**
+     * Start writing pages to outputFile.
+     *
+     * PNG pages go into separate files, numbered from 1: page 2 of out.png is
+     * written to out-2.png, unless there's just one page. The other formats
+     * keep all pages in outputFile. Throws on errors.
+     */
+    void open(const std::string &outputFile);
+
+    /**
+     * Write the next encoded page.
+     *
+     * Whether a page is the last one matters for the file names of PNG and
+     * the layout of TIFF, so each page is held back until the next one comes
+     * or close() is called. Throws on errors.
+     */
+    void writePage(std::vector<uint8_t> page);
+
+    /** \brief Write the last page and finish the output. Throws on errors. */
+    void close();
+
+    /** \brief Get the format by its command line name. Throws on unknown names. */
+    static RasterFormat lookupFormat(const std::string &name);
+
+    /** \brief File name extension of the format, including the dot. */
+    static const char *getExtension(RasterFormat format);
+
+private:
+    /** \brief Draw the page on a new surface of the given format, which only keeps the coverage. */
+    Cairo::RefPtr<Cairo::ImageSurface> render(const PageDisplayList &page, const std::shared_ptr<FontCache> &fontCache,
+        Cairo::Format format) const;
+
+    /** \brief Render the page on a 1-bit surface, returning its rows with the leftmost pixel in the MSB. */
+    std::vector<uint8_t> renderBitmap(const PageDisplayList &page, const std::shared_ptr<FontCache> &fontCache) const;
+
+    /** \brief Render the page in 8-bit grayscale, returning its rows (0 is black). */
+    std::vector<uint8_t> renderGray(const PageDisplayList &page, const std::shared_ptr<FontCache> &fontCache) const;
+
+    /** \brief Write the page held back by writePage(). */
+    void writeHeldPage(bool last);
+
+    /** \brief Write a page of a TIFF: its IFD, the resolution values and the strip (CCITT G4 data). */
+    void writeTiffPage(const std::vector<uint8_t> &strip, bool last);
+
+    /** \brief Write to outputFile (not used for PNG). */
+    void writeData(const std::vector<uint8_t> &data);
+
+    RasterOptions m_options;
+    int m_width;
+    int m_height;
+
+    std::string m_outputFile;
+    std::ofstream m_file;
+    std::optional<BufferedWriter> m_stdoutWriter;
+
+    std::optional<std::vector<uint8_t>> m_heldPage;
+
+    /** \brief Number of pages written so far. */
+    size_t m_pageCount;
+
+    /** \brief Number of bytes written to outputFile so far. */
+    size_t m_offset;
+};
+
+#endif // RASTER_OUTPUT_H_
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REVERSED_BYTES_H_
+#define REVERSED_BYTES_H_
+
+#include <array>
+#include <cstdint>
+
+/** \brief Each byte with the order of its bits reversed. */
+constexpr std::array<uint8_t, 256> makeReversedBytes()
+{
+    std::array<uint8_t, 256> reversed = {};
+    for (unsigned i = 0; i < 256; i++)
+    {
+        for (unsigned bit = 0; bit < 8; bit++)
+        {
+            if (i & (1u << bit))
+                reversed[i] |= static_cast<uint8_t>(0x80u >> bit);
+        }
+    }
+    return reversed;
+}
+
+/**
+ * \brief Lookup table reversing the bits of a byte.
+ *
+ * Cairo keeps A1 pixels in 32-bit words, the first one in the least
+ * significant bit on little endian, while the bitmaps here have the leftmost
+ * dot in the most significant bit.
+ */
+inline constexpr std::array<uint8_t, 256> REVERSED_BYTES = makeReversedBytes();
+
+#endif // REVERSED_BYTES_H_
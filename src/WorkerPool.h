@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2009, 2012, 2014, 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Process items 0 .. count-1 on up to threadCount threads.
+ *
+ * makeWorker() is called once in each thread and must return a callable
+ * taking the item index. This allows each thread to set up its own state
+ * (e.g. its own Converter). Items are handed out in order, each to the
+ * next idle thread.
+ *
+ * If a worker throws, no further items are started and the first exception
+ * is rethrown once all threads have finished.
+ */
+template<typename TMakeWorker>
+void runWorkerPool(size_t count, unsigned threadCount, TMakeWorker makeWorker)
+{
+    threadCount = static_cast<unsigned>(std::min<size_t>(std::max(1u, threadCount), count));
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto threadMain = [&]()
+    {
+        try
+        {
+            auto worker = makeWorker();
+
+            size_t i;
+            while (!failed && (i = next++) < count)
+            {
+                worker(i);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            failed = true;
+        }
+    };
+
+    if (threadCount <= 1)
+    {
+        threadMain();
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back(threadMain);
+        }
+
+        for (std::thread &thread: threads)
+        {
+            thread.join();
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // WORKER_POOL_H_
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BitImage.h"
+
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIT_IMAGE_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    typedef void (*TransposeFunction)(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn,
+        uint8_t *rows, size_t stride);
+
+    /**
+     * Transpose an 8x8 bit matrix.
+     *
+     * The most significant byte is the first row, the most significant bit
+     * of a byte the first column.
+     */
+    inline uint64_t transpose8x8(uint64_t x)
+    {
+        uint64_t t;
+        t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaull;
+        x = x ^ t ^ (t << 7);
+        t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;
+        x = x ^ t ^ (t << 14);
+        t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;
+        x = x ^ t ^ (t << 28);
+        return x;
+    }
+
+    /** \brief Transpose 8 columns (or fewer, padded by empty ones) starting at the given one. */
+    void transposeScalarGroup(const uint8_t *columns, size_t column, size_t columnCount, unsigned bytesPerColumn,
+        uint8_t *rows, size_t stride)
+    {
+        const size_t count = columnCount - column < 8 ? columnCount - column : 8;
+
+        for (unsigned b = 0; b < bytesPerColumn; b++)
+        {
+            uint64_t x = 0;
+            for (size_t i = 0; i < count; i++)
+                x |= static_cast<uint64_t>(columns[(column + i) * bytesPerColumn + b]) << (56 - 8 * i);
+
+            x = transpose8x8(x);
+
+            uint8_t *row = rows + 8 * b * stride + column / 8;
+            for (unsigned i = 0; i < 8; i++, row += stride)
+                *row = static_cast<uint8_t>(x >> (56 - 8 * i));
+        }
+    }
+
+    void transposeScalar(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn, uint8_t *rows,
+        size_t stride)
+    {
+        for (size_t column = 0; column < columnCount; column += 8)
+            transposeScalarGroup(columns, column, columnCount, bytesPerColumn, rows, stride);
+    }
+
+#ifdef BIT_IMAGE_X86
+    /*
+     * The vector kernels take the top bit of each byte at once (movemask),
+     * then shift the bytes up by one, eight times. Within each 8 bytes, the
+     * columns are loaded in reverse order so that the leftmost column lands
+     * in the most significant bit.
+     */
+
+    /** \brief Gather byte b of the columns starting at column, reversed within each 8. */
+    inline void gatherReversed(const uint8_t *columns, size_t column, unsigned bytesPerColumn, unsigned b,
+        uint8_t *out, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            out[(i & ~size_t(7)) + 7 - (i & 7)] = columns[(column + i) * bytesPerColumn + b];
+    }
+
+    __attribute__((target("sse2")))
+    void transposeSse2(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn, uint8_t *rows,
+        size_t stride)
+    {
+        size_t column = 0;
+        for (; columnCount - column >= 16; column += 16)
+        {
+            for (unsigned b = 0; b < bytesPerColumn; b++)
+            {
+                __m128i v;
+                if (bytesPerColumn == 1)
+                {
+                    // reverse the bytes of each half: the words, then the bytes in the words
+                    v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + column));
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                }
+                else
+                {
+                    alignas(16) uint8_t gathered[16];
+                    gatherReversed(columns, column, bytesPerColumn, b, gathered, 16);
+                    v = _mm_load_si128(reinterpret_cast<const __m128i*>(gathered));
+                }
+
+                uint8_t *row = rows + 8 * b * stride + column / 8;
+                for (unsigned i = 0; i < 8; i++, row += stride)
+                {
+                    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(v));
+                    row[0] = static_cast<uint8_t>(mask);
+                    row[1] = static_cast<uint8_t>(mask >> 8);
+                    v = _mm_add_epi8(v, v);
+                }
+            }
+        }
+
+        for (; column < columnCount; column += 8)
+            transposeScalarGroup(columns, column, columnCount, bytesPerColumn, rows, stride);
+    }
+
+    /**
+     * Shuffle masks picking byte b of 16 columns, reversed within each 8, out
+     * of the 16-byte chunks of their interleaved bytes. Indexed by b and
+     * chunk; bytes not in the chunk are zeroed (0x80).
+     */
+    template<unsigned bytesPerColumn>
+    struct DeinterleaveMasks
+    {
+        alignas(32) uint8_t masks[bytesPerColumn][bytesPerColumn][32];
+
+        constexpr DeinterleaveMasks():
+            masks()
+        {
+            for (unsigned b = 0; b < bytesPerColumn; b++)
+            {
+                for (unsigned chunk = 0; chunk < bytesPerColumn; chunk++)
+                {
+                    for (unsigned i = 0; i < 16; i++)
+                    {
+                        const unsigned column = (i & ~7u) + 7 - (i & 7);
+                        const unsigned index = column * bytesPerColumn + b;
+                        const uint8_t mask = index / 16 == chunk ? index % 16 : 0x80;
+
+                        // the same for both 128-bit lanes
+                        masks[b][chunk][i] = mask;
+                        masks[b][chunk][i + 16] = mask;
+                    }
+                }
+            }
+        }
+    };
+
+    /** \brief 32 columns of several bytes; the lower lane holds the first 16, the upper lane the rest. */
+    template<unsigned bytesPerColumn>
+    __attribute__((target("avx2")))
+    void transposeAvx2Interleaved(const uint8_t *columns, uint8_t *rows, size_t stride)
+    {
+        static constexpr DeinterleaveMasks<bytesPerColumn> MASKS;
+
+        __m256i chunks[bytesPerColumn];
+        for (unsigned chunk = 0; chunk < bytesPerColumn; chunk++)
+        {
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + 16 * chunk));
+            const __m128i high = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(columns + 16 * bytesPerColumn + 16 * chunk));
+            chunks[chunk] = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+
+        for (unsigned b = 0; b < bytesPerColumn; b++)
+        {
+            __m256i v = _mm256_setzero_si256();
+            for (unsigned chunk = 0; chunk < bytesPerColumn; chunk++)
+            {
+                const __m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(MASKS.masks[b][chunk]));
+                v = _mm256_or_si256(v, _mm256_shuffle_epi8(chunks[chunk], mask));
+            }
+
+            uint8_t *row = rows + 8 * b * stride;
+            for (unsigned i = 0; i < 8; i++, row += stride)
+            {
+                const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+                row[0] = static_cast<uint8_t>(mask);
+                row[1] = static_cast<uint8_t>(mask >> 8);
+                row[2] = static_cast<uint8_t>(mask >> 16);
+                row[3] = static_cast<uint8_t>(mask >> 24);
+                v = _mm256_add_epi8(v, v);
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void transposeAvx2(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn, uint8_t *rows,
+        size_t stride)
+    {
+        const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+        size_t column = 0;
+        for (; columnCount - column >= 32; column += 32)
+        {
+            // the bytes of 24- and 48-dot columns are taken apart by shuffles
+            if (bytesPerColumn == 3)
+            {
+                transposeAvx2Interleaved<3>(columns + column * 3, rows + column / 8, stride);
+                continue;
+            }
+            else if (bytesPerColumn == 6)
+            {
+                transposeAvx2Interleaved<6>(columns + column * 6, rows + column / 8, stride);
+                continue;
+            }
+
+            for (unsigned b = 0; b < bytesPerColumn; b++)
+            {
+                __m256i v;
+                if (bytesPerColumn == 1)
+                {
+                    v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns + column));
+                    v = _mm256_shuffle_epi8(v, reverse);
+                }
+                else
+                {
+                    alignas(32) uint8_t gathered[32];
+                    gatherReversed(columns, column, bytesPerColumn, b, gathered, 32);
+                    v = _mm256_load_si256(reinterpret_cast<const __m256i*>(gathered));
+                }
+
+                uint8_t *row = rows + 8 * b * stride + column / 8;
+                for (unsigned i = 0; i < 8; i++, row += stride)
+                {
+                    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+                    row[0] = static_cast<uint8_t>(mask);
+                    row[1] = static_cast<uint8_t>(mask >> 8);
+                    row[2] = static_cast<uint8_t>(mask >> 16);
+                    row[3] = static_cast<uint8_t>(mask >> 24);
+                    v = _mm256_add_epi8(v, v);
+                }
+            }
+        }
+
+        // the rest, if any, is less than 32 columns
+        transposeSse2(columns + column * bytesPerColumn, columnCount - column, bytesPerColumn, rows + column / 8,
+            stride);
+    }
+#endif
+
+    TransposeFunction getTransposeFunction(TransposeKernel kernel)
+    {
+        switch (kernel)
+        {
+        case TransposeKernel::Scalar:
+            return transposeScalar;
+#ifdef BIT_IMAGE_X86
+        case TransposeKernel::Sse2:
+            return transposeSse2;
+        case TransposeKernel::Avx2:
+            return transposeAvx2;
+#endif
+        default:
+            throw std::runtime_error("transposeColumns(): kernel not available");
+        }
+    }
+
+    TransposeFunction selectTransposeFunction()
+    {
+        for (TransposeKernel kernel: { TransposeKernel::Avx2, TransposeKernel::Sse2 })
+        {
+            if (isTransposeKernelSupported(kernel))
+                return getTransposeFunction(kernel);
+        }
+
+        return transposeScalar;
+    }
+}
+
+bool isTransposeKernelSupported(TransposeKernel kernel)
+{
+    switch (kernel)
+    {
+    case TransposeKernel::Scalar:
+        return true;
+#ifdef BIT_IMAGE_X86
+    case TransposeKernel::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case TransposeKernel::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+void transposeColumns(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn, uint8_t *rows,
+    size_t stride)
+{
+    static const TransposeFunction transpose = selectTransposeFunction();
+    transpose(columns, columnCount, bytesPerColumn, rows, stride);
+}
+
+void transposeColumns(TransposeKernel kernel, const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn,
+    uint8_t *rows, size_t stride)
+{
+    getTransposeFunction(kernel)(columns, columnCount, bytesPerColumn, rows, stride);
+}
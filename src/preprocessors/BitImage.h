@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIT_IMAGE_H_
+#define BIT_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Turn the columns of printer graphics into rows.
+ *
+ * Printers get graphics column by column: each column is bytesPerColumn
+ * bytes, top to bottom, with the top dot of each byte in the most significant
+ * bit. The rows are written top to bottom, stride bytes apart, with the
+ * leftmost dot in the most significant bit. There are 8 * bytesPerColumn rows
+ * of (columnCount + 7) / 8 bytes; unused bits of the last byte are cleared.
+ *
+ * The fastest kernel the CPU supports is used.
+ */
+void transposeColumns(const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn, uint8_t *rows,
+    size_t stride);
+
+/** \brief Implementations of transposeColumns(), selectable for tests and benchmarks. */
+enum class TransposeKernel
+{
+    /** \brief Portable, 8x8 dots at a time in a 64-bit word. */
+    Scalar,
+
+    /** \brief 16 columns at a time. */
+    Sse2,
+
+    /** \brief 32 columns at a time. */
+    Avx2
+};
+
+bool isTransposeKernelSupported(TransposeKernel kernel);
+
+/** \brief Same as transposeColumns(), using the given kernel. It must be supported. */
+void transposeColumns(TransposeKernel kernel, const uint8_t *columns, size_t columnCount, unsigned bytesPerColumn,
+    uint8_t *rows, size_t stride);
+
+#endif // BIT_IMAGE_H_
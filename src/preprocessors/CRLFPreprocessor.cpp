@@ -18,9 +18,8 @@
  */
 
 #include "CRLFPreprocessor.h"
-
-#include <iostream>
-#include <iomanip>
+#include "ControlCodes.h"
+#include "../Diagnostics.h"
 
 #include <glibmm.h>
 
@@ -44,10 +43,34 @@ void CRLFPreprocessor::process(ICairoTTYProtected &ctty, uint8_t c)
             break;
 
         default:
-            std::cerr << "CRLFPreprocessor::process(): ignoring unknown character 0x"
-                << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(c) << std::endl;
+            Diagnostics::report(DiagnosticSource::CRLFPreprocessor, c);
         }
     }
     else
         ctty.append((char) c);
 }
+
+void CRLFPreprocessor::process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size)
+{
+    const uint8_t * const end = data + size;
+
+    while (data != end)
+    {
+        const uint8_t *runEnd = findControlCode(data, end);
+        if (runEnd != data)
+        {
+            ctty.appendRun(reinterpret_cast<const char*>(data), runEnd - data);
+            data = runEnd;
+        }
+        else
+        {
+            process(ctty, *data);
+            ++data;
+        }
+    }
+}
+
+std::unique_ptr<ICharPreprocessor> CRLFPreprocessor::clone() const
+{
+    return std::make_unique<CRLFPreprocessor>(*this);
+}
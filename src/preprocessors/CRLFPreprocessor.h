@@ -22,10 +22,12 @@
 
 #include "../CairoTTY.h"
 
-class CRLFPreprocessor: public ICharPreprocessor
+class CRLFPreprocessor final: public ICharPreprocessor
 {
 public:
     virtual void process(ICairoTTYProtected &ctty, uint8_t c) override;
+    virtual void process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size) override;
+    virtual std::unique_ptr<ICharPreprocessor> clone() const override;
 };
 
 #endif // CRLF_PREPROCESSOR_H_
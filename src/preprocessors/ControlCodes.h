@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTROL_CODES_H_
+#define CONTROL_CODES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * \brief Find the first control code in [begin, end).
+ *
+ * Control codes are the bytes below 0x20 and DEL (0x7f). Everything else
+ * is printable text. Returns end if there is no control code. The bytes are
+ * checked 8 at a time.
+ */
+inline const uint8_t *findControlCode(const uint8_t *begin, const uint8_t *end)
+{
+    constexpr uint64_t ONES = 0x0101010101010101ull;
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+    const uint8_t *p = begin;
+    for (; end - p >= static_cast<ptrdiff_t>(sizeof(uint64_t)); p += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+
+        // any byte below 0x20, and any byte equal to 0x7f
+        const uint64_t below = (word - ONES * 0x20) & ~word & HIGH_BITS;
+        const uint64_t del = word ^ (ONES * 0x7f);
+        if (below | ((del - ONES) & ~del & HIGH_BITS))
+            break;
+    }
+
+    while (p != end && *p >= 0x20 && *p != 0x7f)
+        ++p;
+
+    return p;
+}
+
+#endif // CONTROL_CODES_H_
@@ -18,25 +18,57 @@
  */
 
 #include "EpsonPreprocessor.h"
+#include "BitImage.h"
+#include "ControlCodes.h"
+#include "../Diagnostics.h"
 
-#include <stdexcept>
-#include <iostream>
-#include <iomanip>
-#include <type_traits>
+#include <algorithm>
+#include <cstring>
 
 #include <glibmm.h>
 
 EpsonPreprocessor::EpsonPreprocessor():
     m_inputState(InputState::InputNormal),
-    m_escapeState(EscapeState::Entered), // not used unless m_inputState is Escape
-    m_fontSizeState(FontSizeState::FontSizeNormal)
+    m_fontSizeState(FontSizeState::FontSizeNormal),
+    m_command(0),
+    m_parameters(),
+    m_parameterCount(0),
+    m_dataRemaining(0),
+    m_dataPart(0),
+    m_partHeader(),
+    m_partHeaderSize(0),
+    m_rasterDecoded(0)
 {}
 
 void EpsonPreprocessor::process(ICairoTTYProtected &ctty, uint8_t c)
 {
-    if (m_inputState == InputState::Escape)
+    switch (m_inputState)
+    {
+    case InputState::Escape:
         handleEscape(ctty, c);
-    else
+        break;
+
+    case InputState::Parameters:
+        handleParameter(ctty, c);
+        break;
+
+    case InputState::NulTerminated:
+        if (c == 0)
+            finishParameters(ctty);
+        break;
+
+    case InputState::Data:
+        if (ESCAPE_COMMANDS[m_command].dataHandler)
+            m_data.push_back(c);
+
+        if (m_partHeaderSize < PART_HEADER_SIZE)
+            m_partHeader[m_partHeaderSize++] = c;
+
+        if (--m_dataRemaining == 0)
+            finishData(ctty);
+        break;
+
+    case InputState::InputNormal:
     {
         // Control codes handled here
         switch (c)
@@ -80,160 +112,448 @@ void EpsonPreprocessor::process(ICairoTTYProtected &ctty, uint8_t c)
 
         case 0x1b: // Escape
             m_inputState = InputState::Escape;
-            m_escapeState = EscapeState::Entered;
             break;
 
         default:
             ctty.append(static_cast<char>(c));
             break;
         }
+        break;
+    }
     }
 }
 
-void EpsonPreprocessor::handleEscape(ICairoTTYProtected &ctty, uint8_t c)
+void EpsonPreprocessor::process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size)
 {
-    // Determine what escape code follows
-    if (m_escapeState == EscapeState::Entered)
+    const uint8_t * const end = data + size;
+
+    while (data != end)
     {
-        switch (c)
+        switch (m_inputState)
         {
-        case 0x45: // Set bold
-            ctty.setFontWeight(FontWeight::Bold);
-            break;
-        case 0x46: // Unset bold
-            ctty.setFontWeight(FontWeight::Normal);
-            break;
-        case 0x34: // Set italic
-            ctty.setFontSlant(FontSlant::Italic);
-            break;
-        case 0x35: // Unset italic
-            ctty.setFontSlant(FontSlant::Normal);
-            break;
-        case 0x2a: // '*': Draw Graphics
-            m_graphicAssembledBytes = 0;
-            m_escapeState = EscapeState::DrawGraphics;
-            break;
-        case 0x2d: // Underline
-            m_escapeState = EscapeState::Underline;
-            break;
-        case 0x33: // '3': Set n/180-inch line spacing
-            m_escapeState = EscapeState::SetLineSpacing;
-            break;
-        case 0x40: // '@': Initialize
-            // TODO: add init for Cairo here
-            m_inputState = InputState::InputNormal; // Leave escape state
+        case InputState::InputNormal:
+        {
+            // text is passed on in runs
+            const uint8_t *runEnd = findControlCode(data, end);
+            if (runEnd != data)
+            {
+                ctty.appendRun(reinterpret_cast<const char*>(data), runEnd - data);
+                data = runEnd;
+                continue;
+            }
             break;
-        case 0x44: // 'D': Set horizontal tabs
-            m_escapeState = EscapeState::SetTabWidth;
+        }
+
+        case InputState::NulTerminated:
+        {
+            const uint8_t *nul = static_cast<const uint8_t*>(memchr(data, 0, end - data));
+            if (!nul)
+                return;
+
+            data = nul;
             break;
-        case 0x78: // 'x': Select LQ or draft
-            m_escapeState = EscapeState::SelectQuality;
+        }
+
+        case InputState::Data:
+        {
+            // take as much of the data as there is at once; the last byte finishes the command
+            const size_t count = std::min<size_t>(m_dataRemaining - 1, end - data);
+            if (ESCAPE_COMMANDS[m_command].dataHandler)
+                m_data.insert(m_data.end(), data, data + count);
+
+            const size_t headerCount = std::min(count, PART_HEADER_SIZE - m_partHeaderSize);
+            std::copy(data, data + headerCount, m_partHeader.begin() + m_partHeaderSize);
+            m_partHeaderSize += headerCount;
+
+            m_dataRemaining -= count;
+            data += count;
+            if (data == end)
+                return;
+
             break;
+        }
 
         default:
-            std::cerr << "EpsonPreprocessor::handleEscape(): ignoring unknown escape ESC 0x"
-                << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(c) << std::endl;
-            m_inputState = InputState::InputNormal; // Leave escape state
+            break;
         }
 
-        /*
-         * If still in the escape state (no change to special), assume
-         * the operation has completed, and exit the escape state.
-         *
-         * This includes the error condition, as no change is done either.
-         */
-        if (m_escapeState == EscapeState::Entered)
+        process(ctty, *data);
+        ++data;
+    }
+}
+
+namespace
+{
+    /** \brief Resolution of a bit image mode of ESC *. */
+    struct BitImageDensity
+    {
+        /** \brief Bytes in each column, 8 dots each. */
+        unsigned bytesPerColumn;
+
+        double dpiX;
+        double dpiY;
+    };
+
+    BitImageDensity getBitImageDensity(uint8_t mode)
+    {
+        // the vertical density is that of a 24-pin printer
+        switch (mode)
         {
-            m_inputState = InputState::InputNormal;
+        // 8-dot columns
+        case 0: return { 1, 60.0, 60.0 };
+        case 1: return { 1, 120.0, 60.0 };
+        case 2: return { 1, 120.0, 60.0 };
+        case 3: return { 1, 240.0, 60.0 };
+        case 4: return { 1, 80.0, 60.0 };
+        case 6: return { 1, 90.0, 60.0 };
+
+        // 24-dot columns
+        case 32: return { 3, 60.0, 180.0 };
+        case 33: return { 3, 120.0, 180.0 };
+        case 38: return { 3, 90.0, 180.0 };
+        case 39: return { 3, 180.0, 180.0 };
+        case 40: return { 3, 360.0, 180.0 };
+
+        // 48-dot columns
+        case 71: return { 6, 180.0, 360.0 };
+        case 72: return { 6, 360.0, 360.0 };
+        case 73: return { 6, 360.0, 360.0 };
+
+        default:
+            // unknown modes at least have the right number of bytes, so that they are skipped
+            if (mode < 32)
+                return { 1, 60.0, 60.0 };
+            else if (mode < 64)
+                return { 3, 60.0, 180.0 };
+            else
+                return { 6, 180.0, 360.0 };
         }
+    }
 
-        return;
+    // ESC * m nL nH: the bytes per column depend on the density m
+    size_t bitImageLength(const uint8_t *parameters)
+    {
+        return (parameters[1] + 256u * parameters[2]) * getBitImageDensity(parameters[0]).bytesPerColumn;
     }
 
-    // For multi-byte escapes:
-    switch (m_escapeState)
+    // ESC K, L, Y and Z nL nH: 8-dot columns
+    size_t eightDotImageLength(const uint8_t *parameters)
     {
-    case EscapeState::Underline: // ESC 0x2d u, turn underline off (0) or on (!0)
-        //std::cerr << "escape: ESC 0x2d " << std::hex << c << std::endl;
-        if (c != 0)
-        {
-            // TODO: Set underline
-            //std::cerr << "EpsonPreprocessor::handleEscape(): Ignoring unsupported escape: SET UNDERLINE" << std::endl;
-        }
-        else
-        {
-            // TODO: Cancel underline
-            //std::cerr << "EpsonPreprocessor::handleEscape(): Ignoring unsupported escape: DROP UNDERLINE" << std::endl;
-        }
-        m_inputState = InputState::InputNormal; // Leave escape state
-        break;
+        return parameters[0] + 256u * parameters[1];
+    }
 
-    case EscapeState::SetLineSpacing:
-        // TODO: implement line spacing in CairoTTY
-        m_inputState = InputState::InputNormal;
-        break;
+    // ESC ^ m nL nH: 9-dot columns in two bytes each
+    size_t nineDotImageLength(const uint8_t *parameters)
+    {
+        return (parameters[1] + 256u * parameters[2]) * 2;
+    }
 
-    case EscapeState::SetTabWidth: // Set width of tabs
-        if (0 == c)
-        {
-            m_inputState = InputState::InputNormal; // Leave escape state
-        }
-        else
+    // ESC ( c nL nH: the extended commands carry their length
+    size_t extendedLength(const uint8_t *parameters)
+    {
+        return parameters[1] + 256u * parameters[2];
+    }
+
+    // ESC C n sets the page length in lines, ESC C NUL n in inches
+    size_t pageLengthLength(const uint8_t *parameters)
+    {
+        return parameters[0] == 0 ? 1 : 0;
+    }
+
+    // ESC & NUL n m: the first part is the header of character n, if there is any character
+    size_t downloadCharacterLength(const uint8_t *parameters)
+    {
+        return parameters[2] >= parameters[1] ? 3 : 0;
+    }
+
+    // ESC . c v h m nL nH: m rows of nL + 256 nH dots
+    size_t getRasterSize(const uint8_t *parameters)
+    {
+        return parameters[3] * ((parameters[4] + 256u * parameters[5] + 7) / 8);
+    }
+
+    size_t rasterLength(const uint8_t *parameters)
+    {
+        const size_t size = getRasterSize(parameters);
+        switch (parameters[0])
         {
-            // TODO: set tab width for CairoTTY or handle tabs here
+        case 0: // uncompressed
+            return size;
+
+        case 1: // run-length encoded, the first part is a counter
+            return size > 0 ? 1 : 0;
+
+        default:
+            // TIFF compressed data (c = 2) follows as separate commands, not as data
+            return 0;
         }
-        break;
+    }
+}
+
+constexpr std::array<EpsonPreprocessor::EscapeCommand, 256> EpsonPreprocessor::makeEscapeCommands()
+{
+    std::array<EscapeCommand, 256> commands = {};
+
+    auto command = [&commands](uint8_t c, uint8_t parameterCount, EscapeHandler handler = nullptr)
+        -> EscapeCommand &
+    {
+        commands[c] = { true, parameterCount, false, nullptr, nullptr, handler, nullptr };
+        return commands[c];
+    };
+
+    // commands without parameters
+    for (uint8_t c: { '#', '0', '1', '2', '4', '5', '6', '7', '8', '9', '<', '=', '>', '@',
+        'E', 'F', 'G', 'H', 'M', 'O', 'P', 'T', 'g', '\x0e', '\x0f' })
+    {
+        command(c, 0);
+    }
+
+    // commands with fixed parameters
+    for (uint8_t c: { ' ', '!', '%', '+', '-', '/', '3', 'A', 'I', 'J', 'N', 'Q', 'R', 'S', 'U', 'W',
+        'a', 'i', 'j', 'k', 'l', 'm', 'p', 'q', 'r', 's', 't', 'w', 'x', '\x19' })
+    {
+        command(c, 1);
+    }
+
+    for (uint8_t c: { '$', '?', '\\', 'c', 'e', 'f' })
+    {
+        command(c, 2);
+    }
+
+    command(':', 3);
+    command('X', 3);
+
+    // tab stops up to a NUL
+    command('B', 0).nulTerminated = true;
+    command('D', 0).nulTerminated = true;
+    command('b', 1).nulTerminated = true;
+
+    // commands followed by data
+    command('C', 1).dataLength = pageLengthLength;
+    command('(', 3).dataLength = extendedLength;
+    command('*', 3).dataLength = bitImageLength;
+    command('^', 3).dataLength = nineDotImageLength;
+    command('&', 3).dataLength = downloadCharacterLength;
+    commands['&'].nextDataLength = &EpsonPreprocessor::nextDownloadCharacterLength;
+    command('.', 6).dataLength = rasterLength;
+    commands['.'].nextDataLength = &EpsonPreprocessor::nextRasterLength;
+    for (uint8_t c: { 'K', 'L', 'Y', 'Z' })
+    {
+        command(c, 2).dataLength = eightDotImageLength;
+    }
+
+    // and the commands that are implemented
+    commands['E'].handler = &EpsonPreprocessor::setBold;
+    commands['F'].handler = &EpsonPreprocessor::unsetBold;
+    commands['4'].handler = &EpsonPreprocessor::setItalic;
+    commands['5'].handler = &EpsonPreprocessor::unsetItalic;
+    commands['0'].handler = &EpsonPreprocessor::setLineSpacing;
+    commands['1'].handler = &EpsonPreprocessor::setLineSpacing;
+    commands['2'].handler = &EpsonPreprocessor::setLineSpacing;
+    commands['3'].handler = &EpsonPreprocessor::setLineSpacing;
+    commands['+'].handler = &EpsonPreprocessor::setLineSpacing;
+    commands['A'].handler = &EpsonPreprocessor::setLineSpacing;
+    for (uint8_t c: { '*', 'K', 'L', 'Y', 'Z' })
+    {
+        commands[c].dataHandler = &EpsonPreprocessor::printBitImage;
+    }
 
-    case EscapeState::SelectQuality:
-        // TODO: select quality?
+    return commands;
+}
+
+const std::array<EpsonPreprocessor::EscapeCommand, 256> EpsonPreprocessor::ESCAPE_COMMANDS = makeEscapeCommands();
+
+void EpsonPreprocessor::handleEscape(ICairoTTYProtected &ctty, uint8_t c)
+{
+    const EscapeCommand &command = ESCAPE_COMMANDS[c];
+    if (!command.known)
+    {
+        // the length of the parameters is not known, continue right after the command
+        Diagnostics::report(DiagnosticSource::EpsonPreprocessor, c);
         m_inputState = InputState::InputNormal;
-        break;
+        return;
+    }
 
-    case EscapeState::DrawGraphics: // Insert tabs in text
-        handleGraphics(ctty, c);
-        break;
+    m_command = c;
+    m_parameterCount = 0;
 
-    default:
-        throw std::runtime_error("EpsonPreprocessor::handleEscape(): Internal error: entered unknown escape state "
-            + std::to_string(static_cast<std::underlying_type_t<decltype(m_escapeState)>>(m_escapeState)));
+    if (command.parameterCount == 0)
+        finishParameters(ctty);
+    else
+        m_inputState = InputState::Parameters;
+}
+
+void EpsonPreprocessor::handleParameter(ICairoTTYProtected &ctty, uint8_t c)
+{
+    m_parameters[m_parameterCount++] = c;
+    if (m_parameterCount == ESCAPE_COMMANDS[m_command].parameterCount)
+        finishParameters(ctty);
+}
+
+void EpsonPreprocessor::finishParameters(ICairoTTYProtected &ctty)
+{
+    const EscapeCommand &command = ESCAPE_COMMANDS[m_command];
+
+    // NUL-terminated parameters end here when the NUL comes
+    if (command.nulTerminated && m_inputState != InputState::NulTerminated)
+    {
+        m_inputState = InputState::NulTerminated;
+        return;
+    }
+
+    m_inputState = InputState::InputNormal;
+
+    if (command.handler)
+        (this->*command.handler)(ctty, m_parameters.data());
+
+    if (command.dataLength)
+    {
+        m_dataPart = 0;
+        m_partHeaderSize = 0;
+        m_rasterDecoded = 0;
+        m_dataRemaining = command.dataLength(m_parameters.data());
+        if (m_dataRemaining > 0)
+            m_inputState = InputState::Data;
     }
 }
 
-void EpsonPreprocessor::handleGraphics(ICairoTTYProtected & /*ctty*/, uint8_t c)
+void EpsonPreprocessor::finishData(ICairoTTYProtected &ctty)
 {
-    if (m_graphicAssembledBytes == 0)
+    const EscapeCommand &command = ESCAPE_COMMANDS[m_command];
+    if (command.nextDataLength)
+    {
+        m_dataRemaining = (this->*command.nextDataLength)(m_partHeader.data());
+        m_dataPart++;
+        m_partHeaderSize = 0;
+        if (m_dataRemaining > 0)
+            return; // stay in the data
+    }
+
+    m_inputState = InputState::InputNormal;
+
+    if (command.dataHandler)
     {
-        m_graphicsMode = c;
-        m_graphicAssembledBytes = 1;
+        (this->*command.dataHandler)(ctty, m_parameters.data(), m_data.data(), m_data.size());
+        m_data.clear();
     }
-    else if (m_graphicAssembledBytes == 1)
+}
+
+void EpsonPreprocessor::setBold(ICairoTTYProtected &ctty, const uint8_t * /*parameters*/)
+{
+    ctty.setFontWeight(FontWeight::Bold);
+}
+
+void EpsonPreprocessor::unsetBold(ICairoTTYProtected &ctty, const uint8_t * /*parameters*/)
+{
+    ctty.setFontWeight(FontWeight::Normal);
+}
+
+void EpsonPreprocessor::setItalic(ICairoTTYProtected &ctty, const uint8_t * /*parameters*/)
+{
+    ctty.setFontSlant(FontSlant::Italic);
+}
+
+void EpsonPreprocessor::unsetItalic(ICairoTTYProtected &ctty, const uint8_t * /*parameters*/)
+{
+    ctty.setFontSlant(FontSlant::Normal);
+}
+
+void EpsonPreprocessor::setLineSpacing(ICairoTTYProtected &ctty, const uint8_t *parameters)
+{
+    constexpr double POINTS_PER_INCH = 72.0;
+
+    switch (m_command)
     {
-        m_graphicsNrColumns = c;
-        m_graphicAssembledBytes = 2;
+    case '0': // 1/8 inch
+        ctty.setLineSpacing(POINTS_PER_INCH / 8);
+        break;
+    case '1': // 7/72 inch
+        ctty.setLineSpacing(7.0);
+        break;
+    case '2': // 1/6 inch, i.e. the default
+        ctty.setLineSpacing(0.0);
+        break;
+    case '3': // n/180 inch
+        ctty.setLineSpacing(parameters[0] * POINTS_PER_INCH / 180);
+        break;
+    case '+': // n/360 inch
+        ctty.setLineSpacing(parameters[0] * POINTS_PER_INCH / 360);
+        break;
+    case 'A': // n/60 inch
+        ctty.setLineSpacing(parameters[0] * POINTS_PER_INCH / 60);
+        break;
     }
-    else if (m_graphicAssembledBytes == 2)
+}
+
+void EpsonPreprocessor::printBitImage(ICairoTTYProtected &ctty, const uint8_t *parameters, const uint8_t *data,
+    size_t /*size*/)
+{
+    // ESC K, L, Y and Z are short forms of ESC * 0 to 3
+    uint8_t mode;
+    switch (m_command)
     {
-        m_graphicsNrColumns += c * 256;
-        m_graphicAssembledBytes = 3;
+    case 'K': mode = 0; break;
+    case 'L': mode = 1; break;
+    case 'Y': mode = 2; break;
+    case 'Z': mode = 3; break;
+    default:
+        mode = parameters[0];
+        ++parameters;
+        break;
     }
-    else
+
+    const BitImageDensity density = getBitImageDensity(mode);
+    const unsigned columns = parameters[0] + 256u * parameters[1];
+
+    GraphicsBand band;
+    band.width = columns;
+    band.height = 8 * density.bytesPerColumn;
+    band.dpiX = density.dpiX;
+    band.dpiY = density.dpiY;
+    band.stride = (columns + 7) / 8;
+
+    m_band.resize(band.stride * band.height);
+    transposeColumns(data, columns, density.bytesPerColumn, m_band.data(), band.stride);
+    band.rows = m_band.data();
+
+    ctty.appendGraphics(band);
+}
+
+size_t EpsonPreprocessor::nextDownloadCharacterLength(const uint8_t *part)
+{
+    // ESC & NUL n m: for each character n to m, a header a0 a1 a2 and a1 columns of 3 bytes
+    const unsigned characterCount = m_parameters[2] - m_parameters[1] + 1u;
+
+    if (m_dataPart % 2 == 0)
     {
-        if (m_graphicAssembledBytes == 3)
-        {
-            m_graphicsMaxBytes = m_graphicsNrColumns * 3;
-        }
+        // a character without columns has no data, go on with the next header
+        if (part[1] > 0)
+            return part[1] * 3u;
 
-        int rowGroup = m_graphicAssembledBytes % 3;
-        m_graphicsCol |= ((unsigned int) c) << (8 * (2 - rowGroup));
-        if (rowGroup == 2)
-        {
-            m_graphicsCol = 0;
-        }
+        m_dataPart++;
+    }
 
-        ++m_graphicAssembledBytes;
-        if (m_graphicAssembledBytes >= (m_graphicsMaxBytes + 3))
-        {
-            m_inputState = InputState::InputNormal; // Leave escape state
-        }
+    return m_dataPart / 2 + 1 < characterCount ? 3 : 0;
+}
+
+size_t EpsonPreprocessor::nextRasterLength(const uint8_t *part)
+{
+    // uncompressed data is read at once
+    if (m_parameters[0] != 1)
+        return 0;
+
+    // ESC . 1: a counter n is followed by n + 1 bytes, or by one byte repeated 257 - n times
+    if (m_dataPart % 2 == 0)
+    {
+        const bool literal = part[0] < 128;
+        m_rasterDecoded += literal ? part[0] + 1u : 257u - part[0];
+        return literal ? part[0] + 1u : 1u;
     }
+
+    return m_rasterDecoded < getRasterSize(m_parameters.data()) ? 1 : 0;
+}
+
+std::unique_ptr<ICharPreprocessor> EpsonPreprocessor::clone() const
+{
+    return std::make_unique<EpsonPreprocessor>(*this);
 }
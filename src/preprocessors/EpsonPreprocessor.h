@@ -20,13 +20,18 @@
 #ifndef EPSON_PREPROCESSOR_H_
 #define EPSON_PREPROCESSOR_H_
 
+#include <array>
+#include <vector>
+
 #include "../CairoTTY.h"
 
-class EpsonPreprocessor: public ICharPreprocessor
+class EpsonPreprocessor final: public ICharPreprocessor
 {
 public:
     EpsonPreprocessor();
     virtual void process(ICairoTTYProtected &ctty, uint8_t c) override;
+    virtual void process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size) override;
+    virtual std::unique_ptr<ICharPreprocessor> clone() const override;
 
     // normal font is expected to be 17 character per inch
     static constexpr int STANDARD_CPI = 17;
@@ -35,24 +40,82 @@ public:
     static constexpr int CONDENSED_CPI = 10;
 
 private:
-    void handleEscape(ICairoTTYProtected &ctty, uint8_t c);
-    void handleGraphics(ICairoTTYProtected &ctty, uint8_t c);
+    typedef void (EpsonPreprocessor::*EscapeHandler)(ICairoTTYProtected &ctty, const uint8_t *parameters);
 
-    enum class InputState
+    typedef void (EpsonPreprocessor::*DataHandler)(ICairoTTYProtected &ctty, const uint8_t *parameters,
+        const uint8_t *data, size_t size);
+
+    /** \brief Number of data bytes following the parameters of a command. */
+    typedef size_t (*DataLength)(const uint8_t *parameters);
+
+    /**
+     * \brief Length of the next part of variable length data.
+     *
+     * Called with the first bytes of the part that has just been read (see
+     * PART_HEADER_SIZE). Returns 0 at the end of the data.
+     */
+    typedef size_t (EpsonPreprocessor::*NextDataLength)(const uint8_t *part);
+
+    /** \brief Layout and handler of the parameters of an escape command. */
+    struct EscapeCommand
     {
-        InputNormal,
-        Escape
+        /** \brief False for the commands that are not known. */
+        bool known;
+
+        /** \brief Number of fixed parameter bytes following the command. */
+        uint8_t parameterCount;
+
+        /** \brief If true, the fixed parameters are followed by bytes up to a NUL. */
+        bool nulTerminated;
+
+        /** \brief Length of the data following the fixed parameters, or nullptr if there is none. */
+        DataLength dataLength;
+
+        /**
+         * \brief For data made of parts, gives the length of each part after the first one.
+         *
+         * The first part is given by dataLength. nullptr if the data is a single part.
+         */
+        NextDataLength nextDataLength;
+
+        /** \brief Called with the fixed parameters, or nullptr if the command is ignored. */
+        EscapeHandler handler;
+
+        /** \brief Called with the data once it's complete, or nullptr if the data is skipped. */
+        DataHandler dataHandler;
     };
 
-    enum class EscapeState
+    // the longest fixed parameters of a known command
+    static constexpr size_t MAX_PARAMETER_COUNT = 6;
+
+    // bytes kept from the start of each part of the data, for NextDataLength
+    static constexpr size_t PART_HEADER_SIZE = 3;
+
+    static constexpr std::array<EscapeCommand, 256> makeEscapeCommands();
+    static const std::array<EscapeCommand, 256> ESCAPE_COMMANDS;
+
+    void handleEscape(ICairoTTYProtected &ctty, uint8_t c);
+    void handleParameter(ICairoTTYProtected &ctty, uint8_t c);
+    void finishParameters(ICairoTTYProtected &ctty);
+    void finishData(ICairoTTYProtected &ctty);
+
+    void setBold(ICairoTTYProtected &ctty, const uint8_t *parameters);
+    void unsetBold(ICairoTTYProtected &ctty, const uint8_t *parameters);
+    void setItalic(ICairoTTYProtected &ctty, const uint8_t *parameters);
+    void unsetItalic(ICairoTTYProtected &ctty, const uint8_t *parameters);
+    void setLineSpacing(ICairoTTYProtected &ctty, const uint8_t *parameters);
+    void printBitImage(ICairoTTYProtected &ctty, const uint8_t *parameters, const uint8_t *data, size_t size);
+
+    size_t nextDownloadCharacterLength(const uint8_t *part);
+    size_t nextRasterLength(const uint8_t *part);
+
+    enum class InputState
     {
-        Entered,
-        Underline,
-        SetLineSpacing,
-        SetTabWidth,
-        SelectQuality,
-        DrawGraphics,
-        Unknown
+        InputNormal,
+        Escape, // waiting for the command byte
+        Parameters, // collecting the fixed parameters
+        NulTerminated, // skipping up to a NUL
+        Data // skipping the data
     };
 
     enum class FontSizeState
@@ -63,16 +126,25 @@ private:
     };
 
     InputState m_inputState;
-    EscapeState m_escapeState;
     FontSizeState m_fontSizeState;
-    //bool m_escape;
-    int m_graphicAssembledBytes;
-    uint8_t m_graphicsMode; // Graphics mode
-    //int m_graphicsDpi; // Dots per inch
-    //int m_graphicsDpc; // Dots per column
-    int m_graphicsNrColumns; // Number of columns
-    int m_graphicsMaxBytes; // Number of columns
-    int m_graphicsCol;
+
+    // command being parsed, valid unless m_inputState is InputNormal or Escape
+    uint8_t m_command;
+    std::array<uint8_t, MAX_PARAMETER_COUNT> m_parameters;
+    size_t m_parameterCount;
+    size_t m_dataRemaining;
+
+    // data made of parts: the part being read, its first bytes and the raster bytes decoded so far
+    size_t m_dataPart;
+    std::array<uint8_t, PART_HEADER_SIZE> m_partHeader;
+    size_t m_partHeaderSize;
+    size_t m_rasterDecoded;
+
+    // data of the command, if it has a data handler
+    std::vector<uint8_t> m_data;
+
+    // graphics band being printed
+    std::vector<uint8_t> m_band;
 };
 
 #endif // EPSON_PREPROCESSOR_H_
@@ -18,9 +18,8 @@
  */
 
 #include "SimplePreprocessor.h"
-
-#include <iostream>
-#include <iomanip>
+#include "ControlCodes.h"
+#include "../Diagnostics.h"
 
 #include <glibmm.h>
 
@@ -40,10 +39,34 @@ void SimplePreprocessor::process(ICairoTTYProtected &ctty, uint8_t c)
             break;
 
         default:
-            std::cerr << "SimplePreprocessor::process(): ignoring unknown character 0x"
-                << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(c) << std::endl;
+            Diagnostics::report(DiagnosticSource::SimplePreprocessor, c);
         }
     }
     else
         ctty.append((char) c);
 }
+
+void SimplePreprocessor::process(ICairoTTYProtected &ctty, const uint8_t *data, size_t size)
+{
+    const uint8_t * const end = data + size;
+
+    while (data != end)
+    {
+        const uint8_t *runEnd = findControlCode(data, end);
+        if (runEnd != data)
+        {
+            ctty.appendRun(reinterpret_cast<const char*>(data), runEnd - data);
+            data = runEnd;
+        }
+        else
+        {
+            process(ctty, *data);
+            ++data;
+        }
+    }
+}
+
+std::unique_ptr<ICharPreprocessor> SimplePreprocessor::clone() const
+{
+    return std::make_unique<SimplePreprocessor>(*this);
+}
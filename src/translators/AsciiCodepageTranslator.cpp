@@ -19,9 +19,22 @@
  */
 
 #include "AsciiCodepageTranslator.h"
+#include "../Diagnostics.h"
 
-#include <iostream>
-#include <iomanip>
+#include <array>
+#include <cstring>
+
+namespace
+{
+    /** \brief All the ASCII characters; each is its own UTF-8 encoding. */
+    const std::array<char, 128> ASCII_CHARACTERS = []()
+    {
+        std::array<char, 128> characters;
+        for (size_t i = 0; i < characters.size(); i++)
+            characters[i] = static_cast<char>(i);
+        return characters;
+    }();
+}
 
 bool AsciiCodepageTranslator::translate(uint8_t in, gunichar &out)
 {
@@ -31,7 +44,73 @@ bool AsciiCodepageTranslator::translate(uint8_t in, gunichar &out)
         return true;
     }
 
-    std::cerr << "AsciiCodepageTranslator::translate(): Droping unknown char 0x"
-        << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(in) << std::endl;
+    reportUnknown(in);
+    return false;
+}
+
+bool AsciiCodepageTranslator::translateUtf8(uint8_t in, gunichar &out, const char *&utf8, size_t &utf8Length)
+{
+    if (in <= 127)
+    {
+        out = in;
+        utf8 = &ASCII_CHARACTERS[in];
+        utf8Length = 1;
+        return true;
+    }
+
+    reportUnknown(in);
     return false;
 }
+
+size_t AsciiCodepageTranslator::translateUtf8(const uint8_t *in, size_t size, TranslatedChar *out)
+{
+    TranslatedChar * const outStart = out;
+    const uint8_t * const end = in + size;
+
+    while (in != end)
+    {
+        const size_t ascii = getAsciiPrefixLength(in, end - in);
+        widenAscii(in, ascii, out);
+        in += ascii;
+        out += ascii;
+
+        if (in != end)
+        {
+            reportUnknown(*in);
+            ++in;
+        }
+    }
+
+    return out - outStart;
+}
+
+size_t AsciiCodepageTranslator::getAsciiPrefixLength(const uint8_t *data, size_t size)
+{
+    constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+    // check 8 bytes at a time
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if (word & HIGH_BITS)
+            break;
+    }
+
+    while (i < size && data[i] <= 127)
+        i++;
+
+    return i;
+}
+
+void AsciiCodepageTranslator::widenAscii(const uint8_t *in, size_t size, TranslatedChar *out)
+{
+    for (size_t i = 0; i < size; i++)
+        out[i] = { in[i], &ASCII_CHARACTERS[in[i]], 1 };
+}
+
+void AsciiCodepageTranslator::reportUnknown(uint8_t in)
+{
+    Diagnostics::report(DiagnosticSource::AsciiCodepageTranslator, in);
+}
@@ -22,12 +22,25 @@
 #define ASCII_CODEPAGE_TRANSLATOR_H_
 
 #include <cstdint>
+#include <cstddef>
+
 #include "../CairoTTY.h"
 
-class AsciiCodepageTranslator : public ICodepageTranslator
+class AsciiCodepageTranslator final : public ICodepageTranslator
 {
 public:
     virtual bool translate(uint8_t in, gunichar &out) override;
+    virtual bool translateUtf8(uint8_t in, gunichar &out, const char *&utf8, size_t &utf8Length) override;
+    virtual size_t translateUtf8(const uint8_t *in, size_t size, TranslatedChar *out) override;
+
+    /** \brief Get the number of ASCII (7-bit) bytes at the beginning of data. */
+    static size_t getAsciiPrefixLength(const uint8_t *data, size_t size);
+
+    /** \brief Translate ASCII bytes to themselves, with the UTF-8 of each pointing to a shared table. */
+    static void widenAscii(const uint8_t *in, size_t size, TranslatedChar *out);
+
+private:
+    void reportUnknown(uint8_t in);
 };
 
 #endif // ASCII_CODEPAGE_TRANSLATOR_H_
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BuiltinCodepages.h"
+#include "../Diagnostics.h"
+
+void BuiltinCodepageFactory::print(std::ostream &s)
+{
+    for (size_t i = 0; i < BUILTIN_CODEPAGE_COUNT; i++)
+    {
+        s << BUILTIN_CODEPAGES[i].name << '\n';
+    }
+}
+
+const BuiltinCodepage *BuiltinCodepageFactory::lookup(const std::string &name)
+{
+    for (size_t i = 0; i < BUILTIN_CODEPAGE_COUNT; i++)
+    {
+        if (name == BUILTIN_CODEPAGES[i].name)
+            return &BUILTIN_CODEPAGES[i];
+    }
+
+    return nullptr;
+}
+
+BuiltinCodepageTranslator::BuiltinCodepageTranslator(const BuiltinCodepage &codepage):
+    m_codepage(codepage)
+{
+    for (unsigned c = 0; c < 256; c++)
+    {
+        if (codepage.isValid(c))
+            setTranslation(c, codepage.table[c]);
+    }
+
+    finishTable();
+}
+
+void BuiltinCodepageTranslator::reportUnknown(uint8_t in)
+{
+    Diagnostics::report(DiagnosticSource::BuiltinCodepageTranslator, in, m_codepage.name);
+}
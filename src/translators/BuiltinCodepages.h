@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUILTIN_CODEPAGES_H_
+#define BUILTIN_CODEPAGES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include <glibmm.h>
+
+#include "TableCodepageTranslator.h"
+
+/**
+ * \brief A codepage table compiled into dotprint.
+ *
+ * The tables are generated at build time from the .trans files in the tables
+ * directory.
+ */
+struct BuiltinCodepage
+{
+    const char *name;
+
+    /** \brief Code point of each byte. Only valid if the byte's bit is set in valid. */
+    gunichar table[256];
+
+    /** \brief Bitmap of the bytes that have a translation. */
+    uint32_t valid[8];
+
+    constexpr bool isValid(uint8_t c) const
+    {
+        return (valid[c / 32] >> (c % 32)) & 1;
+    }
+};
+
+/** \brief The built-in codepages, defined in the generated BuiltinCodepageTables.cpp. */
+extern const BuiltinCodepage BUILTIN_CODEPAGES[];
+extern const size_t BUILTIN_CODEPAGE_COUNT;
+
+class BuiltinCodepageFactory
+{
+public:
+    static void print(std::ostream &s);
+
+    /** \brief Find a built-in codepage by name. Returns nullptr if there is no such codepage. */
+    static const BuiltinCodepage *lookup(const std::string &name);
+
+    BuiltinCodepageFactory() = delete;
+};
+
+/** \brief Translator using a built-in codepage. */
+class BuiltinCodepageTranslator final : public TableCodepageTranslator
+{
+public:
+    explicit BuiltinCodepageTranslator(const BuiltinCodepage &codepage);
+
+protected:
+    virtual void reportUnknown(uint8_t in) override;
+
+private:
+    const BuiltinCodepage &m_codepage;
+};
+
+#endif // BUILTIN_CODEPAGES_H_
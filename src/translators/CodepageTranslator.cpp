@@ -19,6 +19,7 @@
  */
 
 #include "CodepageTranslator.h"
+#include "../Diagnostics.h"
 
 #include <fstream>
 #include <iostream>
@@ -69,7 +70,11 @@ CodepageTranslator::CodepageTranslator(const std::string &tableName)
             std::stringstream ss2(uni.substr(2));
             gunichar unichar;
             ss2 >> std::hex >> unichar;
-            m_table.insert({ch, unichar});
+            if (!hasTranslation(ch))
+            {
+                // if a byte is listed more than once, the first mapping wins
+                setTranslation(ch, unichar);
+            }
         }
     }
 
@@ -78,19 +83,11 @@ CodepageTranslator::CodepageTranslator(const std::string &tableName)
         const int e = errno;
         throw std::system_error(e, std::generic_category(), "can't read " + tableName);
     }
+
+    finishTable();
 }
 
-bool CodepageTranslator::translate(uint8_t in, gunichar &out)
+void CodepageTranslator::reportUnknown(uint8_t in)
 {
-    const auto it = m_table.find(in);
-
-    if (it != m_table.end())
-    {
-        out = it->second;
-        return true;
-    }
-
-    std::cerr << "CodepageTranslator::translate(): Dropping unknown char 0x"
-        << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(in) << std::endl;
-    return false;
+    Diagnostics::report(DiagnosticSource::CodepageTranslator, in);
 }
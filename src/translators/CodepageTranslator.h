@@ -21,30 +21,25 @@
 #ifndef CODEPAGE_TRANSLATOR_H
 #define CODEPAGE_TRANSLATOR_H
 
-#include <map>
 #include <string>
 #include <stdexcept>
 
 #include <glibmm.h>
 
-#include "../CairoTTY.h"
+#include "TableCodepageTranslator.h"
 
 class CodepageTableParseException : public std::runtime_error
 {
     using std::runtime_error::runtime_error;
 };
 
-class CodepageTranslator : public ICodepageTranslator
+class CodepageTranslator final : public TableCodepageTranslator
 {
 public:
     explicit CodepageTranslator(const std::string &tableName);
 
-    virtual bool translate(uint8_t in, gunichar &out) override;
-
-private:
-    typedef std::map<uint8_t, gunichar> TTransTable;
-
-    TTransTable m_table;
+protected:
+    virtual void reportUnknown(uint8_t in) override;
 };
 
 #endif // CODEPAGE_TRANSLATOR_H
@@ -0,0 +1,85 @@
+# Generates the C++ source with the built-in codepages from .trans files.
+#
+# Run as a script:
+#   cmake -DOUTPUT=BuiltinCodepageTables.cpp -DTABLES="cp850.trans;cp852.trans" -P GenerateBuiltinCodepages.cmake
+#
+# Each table is named after its file (without the extension). The .trans
+# format is the one read by CodepageTranslator: "0xNN U+XXXX" on each line,
+# with '#' starting a comment. If a byte is listed more than once, the first
+# mapping wins.
+
+if(NOT OUTPUT OR NOT TABLES)
+    message(FATAL_ERROR "OUTPUT and TABLES must be set")
+endif()
+
+set(content "// Generated by GenerateBuiltinCodepages.cmake from the .trans tables, do not edit.\n\n")
+string(APPEND content "#include <iterator>\n\n")
+string(APPEND content "#include \"translators/BuiltinCodepages.h\"\n\n")
+string(APPEND content "constexpr BuiltinCodepage BUILTIN_CODEPAGES[] =\n{\n")
+
+foreach(table IN LISTS TABLES)
+    get_filename_component(name "${table}" NAME_WE)
+
+    foreach(c RANGE 255)
+        set(codepoint_${c} 0)
+        set(valid_${c} FALSE)
+    endforeach()
+
+    file(STRINGS "${table}" lines)
+    foreach(line IN LISTS lines)
+        # strip the comment and surrounding whitespace
+        string(REGEX REPLACE "#.*$" "" text "${line}")
+        string(STRIP "${text}" text)
+        if(text STREQUAL "")
+            continue()
+        endif()
+
+        if(NOT text MATCHES "^0x([0-9A-Fa-f]+)[ \t]+U\\+([0-9A-Fa-f]+)$")
+            message(FATAL_ERROR "${table}: can't parse line: ${line}")
+        endif()
+
+        math(EXPR byte "0x${CMAKE_MATCH_1}")
+        math(EXPR codepoint "0x${CMAKE_MATCH_2}")
+        if(byte GREATER 255)
+            message(FATAL_ERROR "${table}: character value too high: ${line}")
+        endif()
+
+        if(NOT valid_${byte})
+            set(codepoint_${byte} ${codepoint})
+            set(valid_${byte} TRUE)
+        endif()
+    endforeach()
+
+    string(APPEND content "    {\n        \"${name}\",\n        {")
+    foreach(c RANGE 255)
+        math(EXPR column "${c} % 8")
+        if(column EQUAL 0)
+            string(APPEND content "\n           ")
+        endif()
+        math(EXPR hex "${codepoint_${c}}" OUTPUT_FORMAT HEXADECIMAL)
+        string(APPEND content " ${hex},")
+    endforeach()
+    string(APPEND content "\n        },\n        {\n           ")
+
+    # bitmap of the valid bytes, 32 bytes per word
+    foreach(word RANGE 7)
+        set(bits 0)
+        foreach(bit RANGE 31)
+            math(EXPR c "${word} * 32 + ${bit}")
+            if(valid_${c})
+                math(EXPR bits "${bits} | (1 << ${bit})")
+            endif()
+        endforeach()
+        math(EXPR hex "${bits}" OUTPUT_FORMAT HEXADECIMAL)
+        string(APPEND content " ${hex},")
+    endforeach()
+    string(APPEND content "\n        }\n    },\n")
+endforeach()
+
+string(APPEND content "};\n\n")
+string(APPEND content "constexpr size_t BUILTIN_CODEPAGE_COUNT = std::size(BUILTIN_CODEPAGES);\n")
+
+# only touch the output if it changed, to avoid needless rebuilds
+file(WRITE "${OUTPUT}.tmp" "${content}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
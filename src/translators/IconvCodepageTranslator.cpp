@@ -18,111 +18,132 @@
  */
 
 #include "IconvCodepageTranslator.h"
+#include "../Diagnostics.h"
 
 #include <system_error>
 #include <cerrno>
 #include <iostream>
-#include <iomanip>
 
 namespace
 {
     // Unicode Byte order mark
     constexpr gunichar BOM = 0xfeff;
-}
-
-IconvCodepageTranslator::IconvCodepageTranslator(const std::string &sourceEncodingName):
-    m_iconvDescriptor(iconv_open("UTF−32", sourceEncodingName.c_str()))
-{
-    if (m_iconvDescriptor == (iconv_t)-1)
-    {
-        const int e = errno;
-        throw std::system_error(e, std::generic_category(), "can't create libiconv instance");
-    }
-}
 
-IconvCodepageTranslator::~IconvCodepageTranslator()
-{
-    if (iconv_close(m_iconvDescriptor) == -1)
-    {
-        const int e = errno;
-        std::error_condition errorCondition = std::generic_category().default_error_condition(e);
-        std::cerr << "Can't close icov instance: " << errorCondition.message() << std::endl;
-    }
-}
-
-bool IconvCodepageTranslator::translate(uint8_t in, gunichar &out)
-{
-    /*
-     * Iconv want to put the BOM as the 1st output byte. And for that iconv demands output buffer
-     * with size for 2 codepoints.
+    /**
+     * Convert a single byte by iconv.
+     *
+     * On failure, returns false and sets error to the reason.
      */
-    char * src = reinterpret_cast<char*>(&in);
-    size_t inBytesLeft = sizeof(in);
+    bool convertByte(iconv_t iconvDescriptor, uint8_t in, gunichar &out, std::string &error)
+    {
+        /*
+         * Iconv want to put the BOM as the 1st output byte. And for that iconv demands output buffer
+         * with size for 2 codepoints.
+         */
+        char * src = reinterpret_cast<char*>(&in);
+        size_t inBytesLeft = sizeof(in);
 
-    gunichar outputBuffer[2];
-    char * dest = reinterpret_cast<char*>(&outputBuffer);
-    size_t outBytesLeft = sizeof(outputBuffer);
+        gunichar outputBuffer[2];
+        char * dest = reinterpret_cast<char*>(&outputBuffer);
+        size_t outBytesLeft = sizeof(outputBuffer);
 
-    const size_t r = iconv(m_iconvDescriptor, &src, &inBytesLeft, &dest, &outBytesLeft);
-    const int err = errno;
+        const size_t r = iconv(iconvDescriptor, &src, &inBytesLeft, &dest, &outBytesLeft);
+        const int err = errno;
 
-    if (r == static_cast<size_t>(-1))
-    {
-        std::cerr << "IconvCodePageTranslator: can't convert 0x" << std::setfill('0') << std::setw(2)
-            << std::hex << static_cast<unsigned>(in) << ": ";
+        if (r == static_cast<size_t>(-1))
+        {
+            /*
+             * None of the below is expected: this code assumes a simple single-byte encoding.
+             * Multi-byte encodings could be supported, but the ICodepageTranslator would need
+             * to change. As this is all very old, it doesn't seem like adding this makes sense.
+             * Let's keep this simple.
+             */
+            switch (err)
+            {
+            case EILSEQ:
+                error = "invalid multi-byte sequence; multi-byte encodings are not suppoted";
+                break;
+            case EINVAL:
+                error = "incomplete multi-byte sequence; multi-byte encodings are not supported";
+                break;
+            case E2BIG:
+                error = "a single input byte maps to more than 1 unicode codepoint, this is not supported";
+                break;
+            default:
+                error = "unknown reason " + std::to_string(err);
+                break;
+            }
 
-        /*
-         * None of the below is expected: this code assumes a simple single-byte encoding.
-         * Multi-byte encodings could be supported, but the ICodepageTranslator would need
-         * to change. As this is all very old, it doesn't seem like adding this makes sense.
-         * Let's keep this simple.
-         */
-        switch (err)
+            // start over with the next byte
+            iconv(iconvDescriptor, nullptr, nullptr, nullptr, nullptr);
+            return false;
+        }
+        if (inBytesLeft != 0)
+        {
+            error = "iconv() did not consume input byte, odd";
+            return false;
+        }
+        if (outBytesLeft == sizeof(outputBuffer) - sizeof(outputBuffer[0]))
         {
-        case EILSEQ:
-            std::cerr << "invalid multi-byte sequence; multi-byte encodings are not suppoted";
-            break;
-        case EINVAL:
-            std::cerr << "incomplete multi-byte sequence; multi-byte encodings are not supported";
-            break;
-        case E2BIG:
-            std::cerr << "a single input byte maps to more than 1 unicode codepoint, this is not supported";
-            break;
-        default:
-            std::cerr << "unknown reason " << err;
-            break;
+            // 1 UTF-32 codepoint has been produced - this is the normal case
+            out = outputBuffer[0];
         }
-        std::cerr << std::endl;
-        return false;
-    }
-    if (inBytesLeft != 0)
-    {
-        std::cerr << "IconvCodePageTranslator: iconv() did not consume input byte, odd" << std::endl;
-        return false;
+        else if (outBytesLeft == sizeof(outputBuffer) - 2*sizeof(outputBuffer[0]))
+        {
+            // 2 UTF-32 codepoints have been produced - this s expected to only happen
+            // on the 1st call and the output is expected to consist of the BOM
+            // which we discard followed by the codepoint we really want
+            if (outputBuffer[0] != BOM)
+            {
+                error = "iconv produced 2 output units without the BOM being the first";
+                return false;
+            }
+            out = outputBuffer[1];
+        }
+        else
+        {
+            // very odd
+            error = "iconv produced output with size that is not a multiple of UTF-32 unit";
+            return false;
+        }
+
+        return true;
     }
-    if (outBytesLeft == sizeof(outputBuffer) - sizeof(outputBuffer[0]))
+}
+
+IconvCodepageTranslator::IconvCodepageTranslator(const std::string &sourceEncodingName)
+{
+    iconv_t iconvDescriptor = iconv_open("UTF−32", sourceEncodingName.c_str());
+    if (iconvDescriptor == (iconv_t)-1)
     {
-        // 1 UTF-32 codepoint has been produced - this is the normal case
-        out = outputBuffer[0];
+        const int e = errno;
+        throw std::system_error(e, std::generic_category(), "can't create libiconv instance");
     }
-    else if (outBytesLeft == sizeof(outputBuffer) - 2*sizeof(outputBuffer[0]))
+
+    // it's a single-byte encoding, so just convert all the bytes up front
+    for (unsigned c = 0; c < 256; c++)
     {
-        // 2 UTF-32 codepoints have been produced - this s expected to only happen
-        // on the 1st call and the output is expected to consist of the BOM
-        // which we discard followed by the codepoint we really want
-        if (outputBuffer[0] != BOM)
-        {
-            std::cerr << "IconvCodePageTranslator: iconv produced 2 output units without the BOM being the first" << std::endl;
-            return false;
-        }
-        out = outputBuffer[1];
+        const uint8_t in = static_cast<uint8_t>(c);
+
+        gunichar out;
+        std::string error;
+        if (convertByte(iconvDescriptor, in, out, error))
+            setTranslation(in, out);
+        else
+            m_errors[in] = error;
     }
-    else
+
+    finishTable();
+
+    if (iconv_close(iconvDescriptor) == -1)
     {
-        // very odd
-        std::cerr << "IconvCodePageTranslator: iconv produced output with size that is not a multiple of UTF-32 unit" << std::endl;
-        return false;
+        const int e = errno;
+        std::error_condition errorCondition = std::generic_category().default_error_condition(e);
+        std::cerr << "Can't close icov instance: " << errorCondition.message() << std::endl;
     }
+}
 
-    return true;
+void IconvCodepageTranslator::reportUnknown(uint8_t in)
+{
+    Diagnostics::report(DiagnosticSource::IconvCodepageTranslator, in, m_errors[in].c_str());
 }
@@ -20,23 +20,31 @@
 #ifndef ICONV_CODEPAGE_TRANSLATOR_H
 #define ICONV_CODEPAGE_TRANSLATOR_H
 
+#include <array>
 #include <string>
 
 #include <glibmm.h>
 #include <iconv.h>
 
-#include "../CairoTTY.h"
+#include "TableCodepageTranslator.h"
 
-class IconvCodepageTranslator : public ICodepageTranslator
+/**
+ * \brief Translator using iconv.
+ *
+ * Only single-byte encodings are supported. All the 256 bytes are converted
+ * by iconv when the translator is created, then it's just a table lookup.
+ */
+class IconvCodepageTranslator final : public TableCodepageTranslator
 {
 public:
     explicit IconvCodepageTranslator(const std::string &sourceEncodingName);
-    ~IconvCodepageTranslator();
 
-    virtual bool translate(uint8_t in, gunichar &out) override;
+protected:
+    virtual void reportUnknown(uint8_t in) override;
 
 private:
-    iconv_t m_iconvDescriptor;
+    /** \brief Why the bytes that have no translation couldn't be converted. */
+    std::array<std::string, 256> m_errors;
 };
 
 #endif // ICONV_CODEPAGE_TRANSLATOR_H
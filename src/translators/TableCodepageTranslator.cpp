@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TableCodepageTranslator.h"
+#include "AsciiCodepageTranslator.h"
+
+TableCodepageTranslator::TableCodepageTranslator():
+    m_table{},
+    m_utf8{},
+    m_utf8Length{},
+    m_asciiIdentity(false)
+{}
+
+bool TableCodepageTranslator::translate(uint8_t in, gunichar &out)
+{
+    if (m_valid[in])
+    {
+        out = m_table[in];
+        return true;
+    }
+
+    reportUnknown(in);
+    return false;
+}
+
+bool TableCodepageTranslator::translateUtf8(uint8_t in, gunichar &out, const char *&utf8, size_t &utf8Length)
+{
+    if (m_valid[in])
+    {
+        out = m_table[in];
+        utf8 = m_utf8[in].data();
+        utf8Length = m_utf8Length[in];
+        return true;
+    }
+
+    reportUnknown(in);
+    return false;
+}
+
+size_t TableCodepageTranslator::translateUtf8(const uint8_t *in, size_t size, TranslatedChar *out)
+{
+    TranslatedChar * const outStart = out;
+    const uint8_t * const end = in + size;
+
+    while (in != end)
+    {
+        if (m_asciiIdentity)
+        {
+            const size_t ascii = AsciiCodepageTranslator::getAsciiPrefixLength(in, end - in);
+            AsciiCodepageTranslator::widenAscii(in, ascii, out);
+            in += ascii;
+            out += ascii;
+
+            if (in == end)
+                break;
+        }
+
+        // a byte outside ASCII (or any byte if ASCII isn't mapped to itself)
+        if (m_valid[*in])
+            *out++ = { m_table[*in], m_utf8[*in].data(), m_utf8Length[*in] };
+        else
+            reportUnknown(*in);
+
+        ++in;
+    }
+
+    return out - outStart;
+}
+
+bool TableCodepageTranslator::hasTranslation(uint8_t in) const
+{
+    return m_valid[in];
+}
+
+void TableCodepageTranslator::setTranslation(uint8_t in, gunichar out)
+{
+    m_table[in] = out;
+    m_utf8Length[in] = g_unichar_to_utf8(out, m_utf8[in].data());
+    m_valid[in] = true;
+}
+
+void TableCodepageTranslator::finishTable()
+{
+    m_asciiIdentity = true;
+    for (unsigned c = 0; c < 128; c++)
+    {
+        if (!m_valid[c] || m_table[c] != c)
+        {
+            m_asciiIdentity = false;
+            break;
+        }
+    }
+}
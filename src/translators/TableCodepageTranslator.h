@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 David Kozub <zub at linux.fjfi.cvut.cz>
+ *
+ * This file is part of dotprint.
+ *
+ * dotprint is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * dotprint is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with dotprint. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TABLE_CODEPAGE_TRANSLATOR_H_
+#define TABLE_CODEPAGE_TRANSLATOR_H_
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstddef>
+
+#include <glibmm.h>
+
+#include "../CairoTTY.h"
+
+/**
+ * \brief Translator that looks the bytes up in a table.
+ *
+ * Derived classes fill the table when they are created. Translating is then
+ * just an array lookup.
+ */
+class TableCodepageTranslator : public ICodepageTranslator
+{
+public:
+    virtual bool translate(uint8_t in, gunichar &out) override;
+    virtual bool translateUtf8(uint8_t in, gunichar &out, const char *&utf8, size_t &utf8Length) override;
+    virtual size_t translateUtf8(const uint8_t *in, size_t size, TranslatedChar *out) override;
+
+protected:
+    TableCodepageTranslator();
+
+    /** \brief Get whether the byte has a translation already. */
+    bool hasTranslation(uint8_t in) const;
+
+    void setTranslation(uint8_t in, gunichar out);
+
+    /** \brief Must be called once the whole table has been set. */
+    void finishTable();
+
+    /** \brief Called for each byte that has no translation. */
+    virtual void reportUnknown(uint8_t in) = 0;
+
+private:
+    std::array<gunichar, 256> m_table;
+
+    /** \brief UTF-8 encoding of each entry of m_table. */
+    std::array<std::array<char, 6>, 256> m_utf8;
+    std::array<uint8_t, 256> m_utf8Length;
+
+    /** \brief Bytes that have a translation in m_table. */
+    std::bitset<256> m_valid;
+
+    /** \brief True if all ASCII bytes translate to themselves, allowing a fast path. */
+    bool m_asciiIdentity;
+};
+
+#endif // TABLE_CODEPAGE_TRANSLATOR_H_
@@ -0,0 +1,64 @@
+/*
+ * Microbenchmark of transposeColumns().
+ *
+ * Transposes full-width bands of random graphics with each kernel the CPU
+ * supports and prints the throughput in input bytes per second.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "preprocessors/BitImage.h"
+
+namespace
+{
+    const char *getKernelName(TransposeKernel kernel)
+    {
+        switch (kernel)
+        {
+        case TransposeKernel::Scalar: return "scalar";
+        case TransposeKernel::Sse2: return "sse2";
+        case TransposeKernel::Avx2: return "avx2";
+        }
+
+        return "?";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // a line of 8 inches at 360 dpi, the widest ESC * supports
+    const size_t columnCount = 8 * 360;
+    const size_t bytesToProcess = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256) << 20;
+
+    std::vector<uint8_t> columns(columnCount * 6);
+    for (uint8_t &c: columns)
+        c = static_cast<uint8_t>(std::rand());
+
+    const size_t stride = (columnCount + 7) / 8;
+    std::vector<uint8_t> rows(stride * 8 * 6);
+
+    for (TransposeKernel kernel: { TransposeKernel::Scalar, TransposeKernel::Sse2, TransposeKernel::Avx2 })
+    {
+        if (!isTransposeKernelSupported(kernel))
+            continue;
+
+        for (unsigned bytesPerColumn: { 1u, 3u, 6u })
+        {
+            const size_t bandSize = columnCount * bytesPerColumn;
+            const size_t bands = bytesToProcess / bandSize + 1;
+
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < bands; i++)
+                transposeColumns(kernel, columns.data(), columnCount, bytesPerColumn, rows.data(), stride);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::printf("%-6s %u bytes per column: %8.1f MB/s\n", getKernelName(kernel), bytesPerColumn,
+                bands * bandSize / seconds / (1 << 20));
+        }
+    }
+
+    return 0;
+}
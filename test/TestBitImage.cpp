@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "preprocessors/BitImage.h"
+
+BOOST_AUTO_TEST_CASE(BitImage_transpose8)
+{
+    // a diagonal over 9 columns, so the rows take two bytes
+    const uint8_t columns[] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x80 };
+    const size_t stride = 3; // wider than needed
+    std::vector<uint8_t> rows(8 * stride, 0);
+
+    transposeColumns(columns, sizeof(columns), 1, rows.data(), stride);
+
+    BOOST_TEST(rows[0] == 0x80);
+    BOOST_TEST(rows[1] == 0x80); // the 9th column
+    for (unsigned row = 1; row < 8; row++)
+    {
+        BOOST_TEST(rows[row * stride] == (0x80 >> row));
+        BOOST_TEST(rows[row * stride + 1] == 0);
+    }
+    for (unsigned row = 0; row < 8; row++)
+    {
+        BOOST_TEST(rows[row * stride + 2] == 0); // not written
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BitImage_transpose24)
+{
+    // one column, only the bottom dot of each byte set
+    const uint8_t columns[] = { 0x01, 0x01, 0x01 };
+    std::vector<uint8_t> rows(24, 0);
+
+    transposeColumns(columns, 1, 3, rows.data(), 1);
+
+    for (unsigned row = 0; row < 24; row++)
+    {
+        BOOST_TEST(rows[row] == (row % 8 == 7 ? 0x80 : 0x00));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BitImage_kernels)
+{
+    // compare all the kernels with transposing dot by dot
+    std::vector<uint8_t> columns(6 * 100);
+    uint32_t seed = 1;
+    for (uint8_t &c: columns)
+    {
+        seed = seed * 1103515245 + 12345;
+        c = static_cast<uint8_t>(seed >> 16);
+    }
+
+    for (TransposeKernel kernel: { TransposeKernel::Scalar, TransposeKernel::Sse2, TransposeKernel::Avx2 })
+    {
+        if (!isTransposeKernelSupported(kernel))
+            continue;
+
+        for (unsigned bytesPerColumn: { 1u, 3u, 6u })
+        {
+            for (size_t columnCount: { 0, 1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100 })
+            {
+                const size_t stride = (columnCount + 7) / 8 + 1;
+                const unsigned height = 8 * bytesPerColumn;
+
+                // the extra byte of each row must stay untouched
+                std::vector<uint8_t> rows(stride * height, 0xaa);
+                transposeColumns(kernel, columns.data(), columnCount, bytesPerColumn, rows.data(), stride);
+
+                std::vector<uint8_t> expected(stride * height, 0);
+                for (size_t column = 0; column < columnCount; column++)
+                {
+                    for (unsigned dot = 0; dot < height; dot++)
+                    {
+                        if (columns[column * bytesPerColumn + dot / 8] & (0x80 >> (dot % 8)))
+                            expected[dot * stride + column / 8] |= static_cast<uint8_t>(0x80 >> (column % 8));
+                    }
+                }
+                for (unsigned row = 0; row < height; row++)
+                    expected[row * stride + stride - 1] = 0xaa;
+
+                BOOST_TEST_CONTEXT("kernel " << static_cast<int>(kernel) << ", " << bytesPerColumn
+                    << " bytes per column, " << columnCount << " columns")
+                {
+                    BOOST_TEST(rows == expected, boost::test_tools::per_element());
+                }
+            }
+        }
+    }
+}
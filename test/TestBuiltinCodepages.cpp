@@ -0,0 +1,32 @@
+#include <boost/test/unit_test.hpp>
+
+#include <glibmm.h>
+
+#include "translators/BuiltinCodepages.h"
+
+BOOST_AUTO_TEST_CASE(BuiltinCodepages_lookup)
+{
+    BOOST_TEST(BuiltinCodepageFactory::lookup("cp850") != nullptr);
+    BOOST_TEST(BuiltinCodepageFactory::lookup("cp852") != nullptr);
+    BOOST_TEST(BuiltinCodepageFactory::lookup("cp857") != nullptr);
+    BOOST_TEST(BuiltinCodepageFactory::lookup("cp895") != nullptr);
+    BOOST_TEST(BuiltinCodepageFactory::lookup("nonexisting") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(BuiltinCodepages_translate)
+{
+    BuiltinCodepageTranslator cp850(*BuiltinCodepageFactory::lookup("cp850"));
+    BuiltinCodepageTranslator cp895(*BuiltinCodepageFactory::lookup("cp895"));
+
+    gunichar c;
+    BOOST_TEST(cp850.translate('a', c));
+    BOOST_TEST(c == 'a');
+
+    // ö
+    BOOST_TEST(cp850.translate(0x94, c));
+    BOOST_TEST(c == 0xf6);
+
+    // Č
+    BOOST_TEST(cp895.translate(0x80, c));
+    BOOST_TEST(c == 0x10c);
+}
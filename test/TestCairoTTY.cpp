@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "CairoTTY.h"
+#include "DisplayList.h"
+#include "FontCache.h"
+#include "PreprocessorFactory.h"
+#include "translators/AsciiCodepageTranslator.h"
+
+namespace
+{
+    /** \brief Keeps a copy of each finished page. */
+    class CapturingSink: public IPageSink
+    {
+    public:
+        virtual void addPage(const PageDisplayList &page) override
+        {
+            m_pages.push_back(page);
+        }
+
+        std::vector<PageDisplayList> m_pages;
+    };
+
+    void checkSamePage(const PageDisplayList &expected, const PageDisplayList &actual)
+    {
+        BOOST_TEST((expected.getStyles() == actual.getStyles()));
+        BOOST_TEST(expected.getText() == actual.getText());
+        BOOST_TEST((expected.getBitmapData() == actual.getBitmapData()));
+
+        BOOST_TEST_REQUIRE(expected.getTextRuns().size() == actual.getTextRuns().size());
+        for (size_t i = 0; i < expected.getTextRuns().size(); i++)
+        {
+            const TextRun &e = expected.getTextRuns()[i];
+            const TextRun &a = actual.getTextRuns()[i];
+            BOOST_TEST(e.x == a.x);
+            BOOST_TEST(e.y == a.y);
+            BOOST_TEST(e.style == a.style);
+            BOOST_TEST(e.textOffset == a.textOffset);
+            BOOST_TEST(e.textLength == a.textLength);
+            BOOST_TEST(e.cellWidth == a.cellWidth);
+        }
+
+        BOOST_TEST_REQUIRE(expected.getBitmaps().size() == actual.getBitmaps().size());
+        for (size_t i = 0; i < expected.getBitmaps().size(); i++)
+        {
+            const Bitmap &e = expected.getBitmaps()[i];
+            const Bitmap &a = actual.getBitmaps()[i];
+            BOOST_TEST(e.x == a.x);
+            BOOST_TEST(e.y == a.y);
+            BOOST_TEST(e.dotWidth == a.dotWidth);
+            BOOST_TEST(e.dotHeight == a.dotHeight);
+            BOOST_TEST(e.width == a.width);
+            BOOST_TEST(e.height == a.height);
+            BOOST_TEST(e.dataOffset == a.dataOffset);
+        }
+
+        BOOST_TEST_REQUIRE(expected.getRules().size() == actual.getRules().size());
+        for (size_t i = 0; i < expected.getRules().size(); i++)
+        {
+            const Rule &e = expected.getRules()[i];
+            const Rule &a = actual.getRules()[i];
+            BOOST_TEST(e.x1 == a.x1);
+            BOOST_TEST(e.x2 == a.x2);
+            BOOST_TEST(e.y == a.y);
+            BOOST_TEST(e.width == a.width);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CairoTTY_renderPageMatchesWrite)
+{
+    // wrapped lines, styles, line spacing, bit images, form feeds and pages filled up
+    std::string input;
+    for (unsigned line = 0; line < 150; line++)
+    {
+        switch (line % 7)
+        {
+        case 0: input += "\x1b" "E"; break;
+        case 1: input += "\x1b" "4"; break;
+        case 2: input += "\x0e"; break;
+        case 3: input += "\x0f"; break;
+        case 4: input += "\x12\x1b" "F\x1b" "5"; break;
+        case 5: input += std::string("\x1b" "3", 2) + static_cast<char>(20 + line % 40); break;
+        case 6: input += std::string("\x1bK\x08\x00\xff\x81\x81\x81\x81\x81\x81\xff", 12); break;
+        }
+
+        input += "line " + std::to_string(line) + ' ';
+        input += std::string(line % 3 == 0 ? 150 : 20, 'a' + line % 26);
+        input += "\x14\r\n";
+
+        if (line % 50 == 49)
+            input += '\f';
+    }
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(input.data());
+
+    auto translator = std::make_shared<AsciiCodepageTranslator>();
+    auto fontCache = std::make_shared<FontCache>();
+    const PageSize pageSize(595.0, 842.0);
+    const Margins margins(36.0, 36.0, 36.0, 36.0);
+
+    CapturingSink sequential;
+    {
+        CairoTTY ctty(pageSize, margins, PreprocessorFactory::lookup("epson")(), translator, fontCache, &sequential);
+        ctty.write(data, input.size());
+        ctty.finish();
+    }
+
+    CairoTTY ctty(pageSize, margins, PreprocessorFactory::lookup("epson")(), translator, fontCache, nullptr);
+    const CairoTTY::PageLayout layout = ctty.layoutPages(data, input.size());
+    BOOST_TEST(layout.pageStarts.size() > 3u);
+    // the input ends with a form feed, finish() doesn't deliver the empty page after it
+    BOOST_TEST(layout.lastPageEmpty);
+    BOOST_TEST_REQUIRE(layout.pageStarts.size() == sequential.m_pages.size() + 1);
+
+    // render the pages out of order, each by a TTY of its own like with --page-jobs
+    for (size_t page = sequential.m_pages.size(); page-- > 0;)
+    {
+        CapturingSink paged;
+        CairoTTY pageTTY(pageSize, margins, nullptr, translator, fontCache, &paged);
+        pageTTY.renderPage(data, input.size(), layout.pageStarts[page], page);
+
+        BOOST_TEST_REQUIRE(paged.m_pages.size() == 1u);
+        BOOST_TEST_CONTEXT("page " << page)
+        {
+            checkSamePage(sequential.m_pages[page], paged.m_pages[0]);
+        }
+    }
+}
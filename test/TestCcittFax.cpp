@@ -0,0 +1,48 @@
+#include <boost/test/unit_test.hpp>
+
+#include "CcittFax.h"
+
+BOOST_AUTO_TEST_CASE(CcittFax_white)
+{
+    // each row is V0 (1) against the white line above it, then EOFB (2x 000000000001)
+    const uint8_t rows[] = { 0x00, 0x00 };
+    const std::vector<uint8_t> expected = { 0xc0, 0x04, 0x00, 0x40 };
+
+    BOOST_TEST(encodeCcittG4(rows, 8, 2, 1) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CcittFax_horizontal)
+{
+    // H (001), white 0 (00110101), black 8 (000101)
+    const uint8_t rows[] = { 0xff };
+    const std::vector<uint8_t> expected = { 0x26, 0xa2, 0x80, 0x08, 0x00, 0x80 };
+
+    BOOST_TEST(encodeCcittG4(rows, 8, 1, 1) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CcittFax_vertical)
+{
+    // the first row is H (001), white 2 (0111), black 4 (011), V0 (1); the second one repeats it: 3x V0
+    const uint8_t rows[] = { 0x3c, 0x00, 0x3c, 0x00 };
+    const std::vector<uint8_t> expected = { 0x2e, 0xfc, 0x00, 0x40, 0x04 };
+
+    BOOST_TEST(encodeCcittG4(rows, 8, 2, 2) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CcittFax_longRun)
+{
+    // H, white 0, black 3000 = 2560 (000000011111) + 384 (000000110100) + 56 (000000101000)
+    const std::vector<uint8_t> rows(375, 0xff);
+    const std::vector<uint8_t> expected = { 0x26, 0xa0, 0x3e, 0x06, 0x80, 0x50, 0x00, 0x20, 0x02 };
+
+    BOOST_TEST(encodeCcittG4(rows.data(), 3000, 1, rows.size()) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CcittFax_ignorePadding)
+{
+    // the bits right of the width don't matter
+    const uint8_t clean[] = { 0x3c, 0x00 };
+    const uint8_t padded[] = { 0x3f, 0x03 };
+
+    BOOST_TEST(encodeCcittG4(clean, 6, 2, 1) == encodeCcittG4(padded, 6, 2, 1), boost::test_tools::per_element());
+}
@@ -0,0 +1,34 @@
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+
+#include "CairoTTY.h"
+
+BOOST_AUTO_TEST_CASE(CellGrid_parse)
+{
+    CellGrid grid = CellGrid::parse("10/8", 6);
+    BOOST_TEST(grid.cellWidth == CellGrid::UNITS_PER_INCH / 10);
+    BOOST_TEST(grid.lpi == 8u);
+
+    grid = CellGrid::parse("12", 6);
+    BOOST_TEST(grid.cellWidth == CellGrid::UNITS_PER_INCH / 12);
+    BOOST_TEST(grid.lpi == 6u);
+}
+
+BOOST_AUTO_TEST_CASE(CellGrid_parseFractionalCpi)
+{
+    const CellGrid grid = CellGrid::parse("8.5/6", 6);
+    BOOST_TEST(grid.cellWidth == 120u);
+    BOOST_TEST(grid.lpi == 6u);
+
+    BOOST_TEST(CellGrid::parse("17.", 6).cellWidth == 60u);
+    BOOST_TEST(CellGrid::parse(".5", 6).cellWidth == 2 * CellGrid::UNITS_PER_INCH);
+}
+
+BOOST_AUTO_TEST_CASE(CellGrid_parseRejectsInvalid)
+{
+    for (const char *spec : { "", "10x", "10/6x", "10/", "/6", "0", "10/0", "10/6.5", "8.5.1", "-10", "10 ", "." })
+    {
+        BOOST_CHECK_THROW(CellGrid::parse(spec, 6), std::runtime_error);
+    }
+}
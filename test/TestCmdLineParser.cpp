@@ -0,0 +1,24 @@
+#include <boost/test/unit_test.hpp>
+
+#include <getopt.h>
+
+#include "CmdLineParser.h"
+#include "TestData.h"
+
+BOOST_AUTO_TEST_CASE(CmdLineParser_crlfManifest)
+{
+    const std::string manifest = getTestFile("CmdLineParser", "crlf-manifest.txt").string();
+    char *argv[] = { const_cast<char *>("dotprint"), const_cast<char *>("-b"), const_cast<char *>(manifest.c_str()), nullptr };
+
+    // restart getopt in case another test has parsed arguments before
+    optind = 0;
+    CmdLineParser parser(3, argv);
+
+    BOOST_TEST(parser.isBatch());
+    const std::vector<ConversionJob> &jobs = parser.getJobs();
+    BOOST_TEST_REQUIRE(jobs.size() == 2u);
+    BOOST_TEST(jobs[0].inputFile == "one.prn");
+    BOOST_TEST(jobs[0].outputFile == "first.pdf");
+    BOOST_TEST(jobs[1].inputFile == "two.prn");
+    BOOST_TEST(jobs[1].outputFile == "two.pdf");
+}
@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -48,3 +49,76 @@ BOOST_AUTO_TEST_CASE(CodepageTranslator_simpleTable)
 
     BOOST_TEST(!translator.translate(2, c));
 }
+
+BOOST_AUTO_TEST_CASE(CodepageTranslator_bulkDropsUnknown)
+{
+    CodepageTranslator translator(getTestFile("simple-table.trans"));
+
+    const uint8_t in[] = { 0, 2, 1, 2 };
+    TranslatedChar out[std::size(in)];
+
+    BOOST_TEST(translator.translateUtf8(in, std::size(in), out) == 2u);
+    BOOST_TEST(out[0].c == 0u);
+    BOOST_TEST(out[1].c == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(CodepageTranslator_bulkAsciiFastPath)
+{
+    CodepageTranslator translator(getTestFile("ascii-table.trans"));
+
+    // long enough for the 8 byte blocks, with non-ASCII bytes in between
+    const std::string in = "Hello, world! 0123456789\x80" "abcdefghijklmnop\x81xyz";
+    std::vector<TranslatedChar> out(in.size());
+
+    const size_t count = translator.translateUtf8(reinterpret_cast<const uint8_t*>(in.data()), in.size(), out.data());
+
+    std::vector<gunichar> expected;
+    for (char c: in)
+    {
+        gunichar uc;
+        if (translator.translate(static_cast<uint8_t>(c), uc))
+            expected.push_back(uc);
+    }
+
+    BOOST_REQUIRE(count == expected.size());
+    BOOST_TEST(count == in.size() - 1);
+    std::vector<gunichar> characters;
+    std::string utf8;
+    for (size_t i = 0; i < count; i++)
+    {
+        characters.push_back(out[i].c);
+        utf8.append(out[i].utf8, out[i].utf8Length);
+    }
+    BOOST_TEST(characters == expected, boost::test_tools::per_element());
+    BOOST_TEST(out[24].c == 0xc7u);
+    BOOST_TEST(utf8 == "Hello, world! 0123456789\xc3\x87" "abcdefghijklmnopxyz");
+}
+
+BOOST_AUTO_TEST_CASE(CodepageTranslator_bulkUtf8)
+{
+    CodepageTranslator translator(getTestFile("ascii-table.trans"));
+
+    const std::string in = "a\x80" "b\xff\x81";
+    std::vector<TranslatedChar> out(in.size());
+
+    const size_t count = translator.translateUtf8(reinterpret_cast<const uint8_t*>(in.data()), in.size(), out.data());
+
+    size_t i = 0;
+    for (char c: in)
+    {
+        gunichar uc;
+        const char *utf8;
+        size_t utf8Length;
+        if (translator.translateUtf8(static_cast<uint8_t>(c), uc, utf8, utf8Length))
+        {
+            BOOST_REQUIRE(i < count);
+            BOOST_TEST(out[i].c == uc);
+            // ASCII may come from the fast path, so the encoding can be stored elsewhere
+            BOOST_TEST(std::string(out[i].utf8, out[i].utf8Length) == std::string(utf8, utf8Length));
+            i++;
+        }
+    }
+
+    BOOST_TEST(count == i);
+    BOOST_TEST(std::string(out[1].utf8, out[1].utf8Length) == "\xc3\x87");
+}
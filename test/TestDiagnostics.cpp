@@ -0,0 +1,143 @@
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "CairoTTY.h"
+#include "Diagnostics.h"
+#include "FontCache.h"
+#include "PreprocessorFactory.h"
+#include "translators/AsciiCodepageTranslator.h"
+
+BOOST_AUTO_TEST_CASE(Diagnostics_counts)
+{
+    Diagnostics::clear();
+
+    Diagnostics::report(DiagnosticSource::EpsonPreprocessor, 0x7e);
+    Diagnostics::report(DiagnosticSource::EpsonPreprocessor, 0x7e);
+    Diagnostics::report(DiagnosticSource::CRLFPreprocessor, 0x7e);
+
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::EpsonPreprocessor, 0x7e) == 2u);
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::CRLFPreprocessor, 0x7e) == 1u);
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::EpsonPreprocessor, 0x7f) == 0u);
+
+    Diagnostics::clear();
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::EpsonPreprocessor, 0x7e) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics_translator)
+{
+    Diagnostics::clear();
+
+    AsciiCodepageTranslator translator;
+    const uint8_t input[] = { 'a', 0x80, 'b', 0x80, 0xff };
+    TranslatedChar output[sizeof(input)];
+    BOOST_TEST(translator.translateUtf8(input, sizeof(input), output) == 2u);
+
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::AsciiCodepageTranslator, 0x80) == 2u);
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::AsciiCodepageTranslator, 0xff) == 1u);
+
+    Diagnostics::clear();
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics_suppressor)
+{
+    Diagnostics::clear();
+
+    {
+        Diagnostics::Suppressor suppressor;
+        Diagnostics::report(DiagnosticSource::EpsonPreprocessor, 0x7e);
+    }
+    Diagnostics::report(DiagnosticSource::EpsonPreprocessor, 0x7e);
+
+    BOOST_TEST(Diagnostics::getCount(DiagnosticSource::EpsonPreprocessor, 0x7e) == 1u);
+
+    Diagnostics::clear();
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics_pageJobsCountOnce)
+{
+    // unknown characters, control characters and escapes on three pages
+    std::string input;
+    for (unsigned page = 0; page < 3; page++)
+    {
+        for (unsigned line = 0; line < 10; line++)
+            input += "a\x80" "b\x01" "c\x1by\r\n";
+        input += '\f';
+    }
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(input.data());
+
+    auto translator = std::make_shared<AsciiCodepageTranslator>();
+    auto fontCache = std::make_shared<FontCache>();
+    const PageSize pageSize(595.0, 842.0);
+    const Margins margins(36.0, 36.0, 36.0, 36.0);
+
+    auto getCounts = []()
+    {
+        return std::array<uint64_t, 3>{{ Diagnostics::getCount(DiagnosticSource::AsciiCodepageTranslator, 0x80),
+            Diagnostics::getCount(DiagnosticSource::CairoTTY, 0x01),
+            Diagnostics::getCount(DiagnosticSource::EpsonPreprocessor, 'y') }};
+    };
+
+    // converted in one go
+    Diagnostics::clear();
+    {
+        CairoTTY ctty(pageSize, margins, PreprocessorFactory::lookup("epson")(), translator, fontCache, nullptr);
+        ctty.write(data, input.size());
+        ctty.finish();
+    }
+    const std::array<uint64_t, 3> sequential = getCounts();
+
+    // laid out first, then each page rendered on its own like with --page-jobs
+    Diagnostics::clear();
+    {
+        CairoTTY ctty(pageSize, margins, PreprocessorFactory::lookup("epson")(), translator, fontCache, nullptr);
+        const CairoTTY::PageLayout layout = ctty.layoutPages(data, input.size());
+        BOOST_TEST(layout.pageStarts.size() == 4u);
+
+        for (size_t page = 0; page < layout.pageStarts.size(); page++)
+        {
+            CairoTTY pageTTY(pageSize, margins, nullptr, translator, fontCache, nullptr);
+            pageTTY.renderPage(data, input.size(), layout.pageStarts[page], page);
+        }
+    }
+    const std::array<uint64_t, 3> paged = getCounts();
+
+    BOOST_TEST(sequential[0] == 30u);
+    BOOST_TEST(sequential == paged, boost::test_tools::per_element());
+
+    Diagnostics::clear();
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics_summary)
+{
+    Diagnostics::clear();
+
+    std::ostringstream empty;
+    Diagnostics::printSummary(empty, Diagnostics::Format::Text);
+    BOOST_TEST(empty.str().empty());
+
+    Diagnostics::report(DiagnosticSource::CodepageTranslator, 0x9b);
+    Diagnostics::report(DiagnosticSource::CodepageTranslator, 0x9b);
+    Diagnostics::report(DiagnosticSource::EpsonPreprocessor, 0x0a);
+
+    std::ostringstream tsv;
+    Diagnostics::printSummary(tsv, Diagnostics::Format::Tsv);
+    BOOST_TEST(tsv.str() == "CodepageTranslator\t0x9b\t2\nEpsonPreprocessor\t0x0a\t1\n");
+
+    std::ostringstream text;
+    Diagnostics::printSummary(text, Diagnostics::Format::Text);
+    BOOST_TEST(text.str() == "CodepageTranslator: dropping unknown character 0x9b: 2 times\n"
+        "EpsonPreprocessor: ignoring unknown escape ESC 0x0a: 1 time\n");
+
+    Diagnostics::clear();
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics_lookupFormat)
+{
+    BOOST_TEST((Diagnostics::lookupFormat("tsv") == Diagnostics::Format::Tsv));
+    BOOST_CHECK_THROW(Diagnostics::lookupFormat("xml"), std::runtime_error);
+}
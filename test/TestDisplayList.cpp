@@ -0,0 +1,92 @@
+#include <boost/test/unit_test.hpp>
+
+#include "DisplayList.h"
+
+BOOST_AUTO_TEST_CASE(DisplayList_styles)
+{
+    PageDisplayList page;
+
+    const TextStyle normal = { "Courier New", 11.0, FontWeight::Normal, FontSlant::Normal, 1.0, 1.0 };
+    const TextStyle bold = { "Courier New", 11.0, FontWeight::Bold, FontSlant::Normal, 1.0, 1.0 };
+
+    BOOST_TEST(page.addStyle(normal) == 0u);
+    BOOST_TEST(page.addStyle(bold) == 1u);
+    BOOST_TEST(page.addStyle(normal) == 0u);
+    BOOST_TEST(page.getStyles().size() == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(DisplayList_text)
+{
+    PageDisplayList page;
+    BOOST_TEST(page.empty());
+
+    page.addText(10.0, 20.0, 0, "ab", 2);
+    page.addText(30.0, 20.0, 0, "\xc3\xb6", 2);
+
+    BOOST_TEST(!page.empty());
+    BOOST_REQUIRE(page.getTextRuns().size() == 2u);
+
+    const TextRun &run = page.getTextRuns()[1];
+    BOOST_TEST(run.x == 30.0);
+    BOOST_TEST(page.getText().substr(run.textOffset, run.textLength) == "\xc3\xb6");
+
+    page.clear();
+    BOOST_TEST(page.empty());
+    BOOST_TEST(page.getText().empty());
+}
+
+BOOST_AUTO_TEST_CASE(DisplayList_appendText)
+{
+    PageDisplayList page;
+
+    page.addText(10.0, 20.0, 0, "a", 1);
+    page.appendText("b", 1);
+    page.appendText("\xc3\xb6", 2);
+    page.addText(10.0, 30.0, 0, "c", 1);
+
+    BOOST_REQUIRE(page.getTextRuns().size() == 2u);
+
+    const TextRun &run = page.getTextRuns()[0];
+    BOOST_TEST(page.getText().substr(run.textOffset, run.textLength) == "ab\xc3\xb6");
+
+    const TextRun &next = page.getTextRuns()[1];
+    BOOST_TEST(page.getText().substr(next.textOffset, next.textLength) == "c");
+}
+
+BOOST_AUTO_TEST_CASE(DisplayList_rulesMerge)
+{
+    PageDisplayList page;
+
+    page.addRule({0.0, 5.0, 10.0, 0.5});
+    page.addRule({5.0, 8.0, 10.0, 0.5}); // continues the first one
+    page.addRule({9.0, 12.0, 10.0, 0.5}); // a gap
+
+    BOOST_REQUIRE(page.getRules().size() == 2u);
+    BOOST_TEST(page.getRules()[0].x2 == 8.0);
+    BOOST_TEST(page.getRules()[1].x1 == 9.0);
+}
+
+BOOST_AUTO_TEST_CASE(DisplayList_bitmaps)
+{
+    PageDisplayList page;
+
+    // 10 dots wide, stored with a wider stride
+    const uint8_t rows[] = { 0xff, 0xc0, 0x00, 0x80, 0x40, 0x00 };
+    page.addBitmap(10.0, 20.0, 0.6, 0.4, 10, 2, rows, 3);
+
+    BOOST_TEST(!page.empty());
+    BOOST_REQUIRE(page.getBitmaps().size() == 1u);
+
+    const Bitmap &bitmap = page.getBitmaps()[0];
+    BOOST_TEST(bitmap.width == 10u);
+    BOOST_TEST(bitmap.height == 2u);
+
+    // the rows are packed
+    const std::vector<uint8_t> expected = { 0xff, 0xc0, 0x80, 0x40 };
+    const std::vector<uint8_t> data(page.getBitmapData().begin() + bitmap.dataOffset, page.getBitmapData().end());
+    BOOST_TEST(data == expected, boost::test_tools::per_element());
+
+    page.clear();
+    BOOST_TEST(page.empty());
+    BOOST_TEST(page.getBitmapData().empty());
+}
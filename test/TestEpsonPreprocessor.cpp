@@ -1,6 +1,9 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/fakeit.hpp>
 
+#include <algorithm>
+#include <string>
+
 #include "preprocessors/EpsonPreprocessor.h"
 
 using fakeit::Mock;
@@ -82,3 +85,232 @@ BOOST_AUTO_TEST_CASE(EpsonPreprocessor_condensed)
     Verify(Method(cttyMock, stretchFont).Using(1.0, 1.0)).Once();
     VerifyNoOtherInvocations(cttyMock);
 }
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_underlineIgnored)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+
+    // ESC - n is not supported, its parameter must not be printed
+    const std::string input = "a\x1b-1b\x1b-0c";
+    preprocessor.process(cttyMock.get(), reinterpret_cast<const uint8_t*>(input.data()), input.size());
+
+    auto isChar = [](char expected)
+    {
+        return [expected](const char *data, size_t size) { return size == 1 && *data == expected; };
+    };
+
+    Verify(Method(cttyMock, appendRun).Matching(isChar('a')),
+        Method(cttyMock, appendRun).Matching(isChar('b')),
+        Method(cttyMock, appendRun).Matching(isChar('c'))).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_textRun)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+    Fake(Method(cttyMock, setFontWeight));
+    Fake(Method(cttyMock, lineFeed));
+
+    const std::string input = "first line\x1b" "Ebold\n";
+    preprocessor.process(cttyMock.get(), reinterpret_cast<const uint8_t*>(input.data()), input.size());
+
+    auto isRun = [](const std::string &expected)
+    {
+        return [expected](const char *data, size_t size) { return std::string(data, size) == expected; };
+    };
+
+    Verify(Method(cttyMock, appendRun).Matching(isRun("first line")),
+        Method(cttyMock, setFontWeight).Using(FontWeight::Bold),
+        Method(cttyMock, appendRun).Matching(isRun("bold")),
+        Method(cttyMock, lineFeed)).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_splitEscape)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+    Fake(Method(cttyMock, setLineSpacing));
+
+    // ESC 3 n split after ESC and after '3'
+    const uint8_t first[] = { 'a', 0x1b };
+    const uint8_t second[] = { '3' };
+    const uint8_t third[] = { 45, 'b' };
+    preprocessor.process(cttyMock.get(), first, sizeof(first));
+    preprocessor.process(cttyMock.get(), second, sizeof(second));
+    preprocessor.process(cttyMock.get(), third, sizeof(third));
+
+    Verify(Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'a'; }),
+        Method(cttyMock, setLineSpacing).Using(18.0),
+        Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'b'; }))
+        .Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_skipParameters)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, append));
+
+    // ESC ! n: master select is not implemented, n must not be printed
+    const uint8_t input[] = { 0x1b, '!', 'x', 'a' };
+    for (uint8_t c: input)
+        preprocessor.process(cttyMock.get(), c);
+
+    Verify(Method(cttyMock, append).Using('a')).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_skipTabs)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, append));
+
+    // ESC D: tab stops up to a NUL
+    const uint8_t input[] = { 0x1b, 'D', 8, 'x', 24, 0, 'a' };
+    for (uint8_t c: input)
+        preprocessor.process(cttyMock.get(), c);
+
+    Verify(Method(cttyMock, append).Using('a')).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_skipDownloadCharacters)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, append));
+
+    // ESC & NUL 'A' 'C': A has 2 columns, B none and C one, 3 bytes each
+    const uint8_t input[] = { 0x1b, '&', 0, 'A', 'C',
+        0, 2, 0, 'x', 'x', 'x', 'x', 'x', 'x',
+        0, 0, 0,
+        1, 1, 1, 0x1b, 'x', 0x0c,
+        'a' };
+    for (uint8_t c: input)
+        preprocessor.process(cttyMock.get(), c);
+
+    Verify(Method(cttyMock, append).Using('a')).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_skipRaster)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+
+    // ESC . 0 v h m nL nH: 2 rows of 9 dots, 2 bytes each, split between two blocks
+    const uint8_t first[] = { 0x1b, '.', 0, 20, 20, 2, 9, 0, 'x', 0x1b };
+    const uint8_t second[] = { '\n', 0x0c, 'a' };
+    preprocessor.process(cttyMock.get(), first, sizeof(first));
+    preprocessor.process(cttyMock.get(), second, sizeof(second));
+
+    Verify(Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'a'; }))
+        .Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_skipCompressedRaster)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+
+    // ESC . 1: one row of 40 dots (5 bytes) as 2 literal bytes and a byte repeated 3 times
+    const uint8_t input[] = { 0x1b, '.', 1, 20, 20, 1, 40, 0,
+        1, 'x', 0x1b,
+        254, 'x',
+        'a' };
+    preprocessor.process(cttyMock.get(), input, sizeof(input));
+
+    Verify(Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'a'; }))
+        .Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_graphics)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendRun));
+    Fake(Method(cttyMock, appendGraphics));
+
+    // ESC * 33 (24 dots, 120 dpi) with 2 columns of 3 bytes, split between two blocks
+    const uint8_t first[] = { 'a', 0x1b, '*', 33, 2, 0, 0xff, 0x00 };
+    const uint8_t second[] = { 0x81, 0x80, 0x01, 0x00, 'b' };
+    preprocessor.process(cttyMock.get(), first, sizeof(first));
+    preprocessor.process(cttyMock.get(), second, sizeof(second));
+
+    auto isBand = [](const GraphicsBand &band)
+    {
+        if (band.width != 2 || band.height != 24 || band.dpiX != 120.0 || band.dpiY != 180.0 || band.stride != 1)
+            return false;
+
+        // the first column is 0xff 0x00 0x81, the second 0x80 0x01 0x00
+        const uint8_t expected[24] = { 0xc0, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,
+            0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80 };
+        return std::equal(expected, expected + 24, band.rows);
+    };
+
+    Verify(Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'a'; }),
+        Method(cttyMock, appendGraphics).Matching(isBand),
+        Method(cttyMock, appendRun).Matching([](const char *data, size_t size) { return size == 1 && *data == 'b'; }))
+        .Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_graphicsShortForm)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, appendGraphics));
+
+    // ESC K: 8 dots, 60 dpi
+    const uint8_t input[] = { 0x1b, 'K', 3, 0, 0x80, 0x40, 0x01 };
+    for (uint8_t c: input)
+        preprocessor.process(cttyMock.get(), c);
+
+    Verify(Method(cttyMock, appendGraphics).Matching([](const GraphicsBand &band)
+    {
+        const uint8_t expected[8] = { 0x80, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20 };
+        return band.width == 3 && band.height == 8 && band.dpiX == 60.0 && band.dpiY == 60.0
+            && std::equal(expected, expected + 8, band.rows);
+    })).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
+
+BOOST_AUTO_TEST_CASE(EpsonPreprocessor_lineSpacing)
+{
+    EpsonPreprocessor preprocessor;
+
+    fakeit::Mock<ICairoTTYProtected> cttyMock;
+    Fake(Method(cttyMock, setLineSpacing));
+
+    // ESC 3 24: 24/180 inch, then ESC 2 back to the default
+    const uint8_t input[] = { 0x1b, '3', 24, 0x1b, '2' };
+    for (uint8_t c: input)
+        preprocessor.process(cttyMock.get(), c);
+
+    Verify(Method(cttyMock, setLineSpacing).Using(24 * 72.0 / 180),
+        Method(cttyMock, setLineSpacing).Using(0.0)).Once();
+    VerifyNoOtherInvocations(cttyMock);
+}
@@ -24,3 +24,17 @@ BOOST_AUTO_TEST_CASE(IconvCodepageTranslator_unknownEncoding)
 {
     BOOST_CHECK_THROW(IconvCodepageTranslator("nonexisting"), std::system_error);
 }
+
+BOOST_AUTO_TEST_CASE(IconvCodepageTranslator_unmappable)
+{
+    IconvCodepageTranslator translator("ASCII");
+
+    gunichar c;
+    BOOST_TEST(!translator.translate(0x80, c));
+
+    const uint8_t in[] = { 'a', 0x80, 'b' };
+    TranslatedChar out[std::size(in)];
+    BOOST_TEST(translator.translateUtf8(in, std::size(in), out) == 2u);
+    BOOST_TEST(out[0].c == 'a');
+    BOOST_TEST(out[1].c == 'b');
+}
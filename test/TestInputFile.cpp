@@ -0,0 +1,51 @@
+#include <string>
+#include <system_error>
+
+#include <boost/test/unit_test.hpp>
+
+#include "TestData.h"
+#include "InputFile.h"
+
+namespace
+{
+    std::filesystem::path getTestFile(const std::string & s)
+    {
+        return ::getTestFile("InputFile", s);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(InputFile_fileNotFound)
+{
+    BOOST_CHECK_THROW(InputFile("non-existent-file"), std::system_error);
+}
+
+BOOST_AUTO_TEST_CASE(InputFile_readWholeFile)
+{
+    InputFile input(getTestFile("short.prn"));
+
+    std::string contents;
+    const uint8_t *data;
+    size_t size;
+    while (input.read(data, size))
+    {
+        contents.append(reinterpret_cast<const char*>(data), size);
+    }
+
+    BOOST_TEST(contents == "abc\r\n\x1b\x45" "bold\x0c");
+    BOOST_TEST(input.getBytesRead() == contents.size());
+
+    // stays at the end
+    BOOST_TEST(!input.read(data, size));
+}
+
+BOOST_AUTO_TEST_CASE(InputFile_readAll)
+{
+    InputFile input(getTestFile("short.prn"));
+
+    const uint8_t *data;
+    size_t size;
+    input.readAll(data, size);
+
+    BOOST_TEST(std::string(reinterpret_cast<const char*>(data), size) == "abc\r\n\x1b\x45" "bold\x0c");
+    BOOST_TEST(input.getBytesRead() == size);
+}
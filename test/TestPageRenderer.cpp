@@ -0,0 +1,101 @@
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cairomm/cairomm.h>
+
+#include "DisplayList.h"
+#include "FontCache.h"
+#include "PageRenderer.h"
+
+namespace
+{
+    // a 16x2 dot bitmap
+    const uint8_t LOGO[] = { 0xff, 0x81, 0x81, 0xff };
+    const uint8_t SIGNATURE[] = { 0x3c, 0x42, 0x42, 0x3c };
+
+    enum class Rendering
+    {
+        /** \brief One renderer draws all pages into the PDF. */
+        Sequential,
+
+        /** \brief Each page is drawn into the PDF by a renderer of its own. */
+        RendererPerPage,
+
+        /** \brief Each page is recorded by a renderer of its own and then painted into the PDF, like --page-jobs. */
+        RecordingPerPage
+    };
+
+    /** \brief Render the pages, each with the given bitmap, into a PDF and count its image XObjects. */
+    size_t countImages(const std::vector<const uint8_t*> &pageBitmaps, Rendering rendering = Rendering::Sequential)
+    {
+        std::string pdf;
+        auto surface = Cairo::PdfSurface::create_for_stream(
+            [&pdf](const unsigned char *data, unsigned int length)
+            {
+                pdf.append(reinterpret_cast<const char*>(data), length);
+                return CAIRO_STATUS_SUCCESS;
+            }, 200.0, 200.0);
+
+        auto fontCache = std::make_shared<FontCache>();
+        if (rendering == Rendering::RecordingPerPage)
+        {
+            auto context = Cairo::Context::create(surface);
+            for (size_t i = 0; i < pageBitmaps.size(); i++)
+            {
+                auto recording = Cairo::RecordingSurface::create(Cairo::Rectangle{ 0.0, 0.0, 200.0, 200.0 });
+                {
+                    PageRenderer renderer(recording, fontCache, false);
+                    PageDisplayList page;
+                    page.addBitmap(10.0, 10.0, 0.4, 0.4, 16, 2, pageBitmaps[i], 2);
+                    renderer.addPage(page);
+                }
+
+                context->set_source(recording, 0.0, 0.0);
+                context->paint();
+                if (i + 1 < pageBitmaps.size())
+                    context->show_page();
+            }
+        }
+        else
+        {
+            auto renderer = std::make_unique<PageRenderer>(surface, fontCache);
+            for (const uint8_t *rows: pageBitmaps)
+            {
+                if (rendering == Rendering::RendererPerPage)
+                    renderer = std::make_unique<PageRenderer>(surface, fontCache);
+
+                PageDisplayList page;
+                page.addBitmap(10.0, 10.0, 0.4, 0.4, 16, 2, rows, 2);
+                renderer->addPage(page);
+            }
+        }
+        surface->finish();
+
+        size_t count = 0;
+        for (size_t pos = pdf.find("/Subtype /Image"); pos != std::string::npos; pos = pdf.find("/Subtype /Image", pos + 1))
+            count++;
+
+        return count;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PageRenderer_sameBitmapStoredOnce)
+{
+    const size_t single = countImages({ LOGO });
+    BOOST_TEST(single == 1u);
+
+    BOOST_TEST(countImages({ LOGO, LOGO }) == single);
+    BOOST_TEST(countImages({ LOGO, LOGO }, Rendering::RendererPerPage) == single);
+    BOOST_TEST(countImages({ LOGO, LOGO }, Rendering::RecordingPerPage) == single);
+}
+
+BOOST_AUTO_TEST_CASE(PageRenderer_differentBitmapsStoredSeparately)
+{
+    // the same size, but different content
+    BOOST_TEST(countImages({ LOGO, SIGNATURE }) == 2u);
+    BOOST_TEST(countImages({ LOGO, SIGNATURE }, Rendering::RendererPerPage) == 2u);
+    BOOST_TEST(countImages({ LOGO, SIGNATURE }, Rendering::RecordingPerPage) == 2u);
+}
@@ -0,0 +1,26 @@
+#include <boost/test/unit_test.hpp>
+
+#include "PreprocessorFactory.h"
+
+BOOST_AUTO_TEST_CASE(PreprocessorFactory_unknown)
+{
+    BOOST_TEST(PreprocessorFactory::lookup("nonexisting") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(PreprocessorFactory_separateInstances)
+{
+    // each document must get its own preprocessor state
+    const PreprocessorFactory::TCreator create = PreprocessorFactory::lookup("epson");
+    BOOST_REQUIRE(create != nullptr);
+
+    auto p1 = create();
+    auto p2 = create();
+    BOOST_TEST(p1.get() != nullptr);
+    BOOST_TEST(p2.get() != nullptr);
+    BOOST_TEST(p1.get() != p2.get());
+}
+
+BOOST_AUTO_TEST_CASE(PreprocessorFactory_default)
+{
+    BOOST_CHECK(PreprocessorFactory::getDefault() == PreprocessorFactory::lookup("epson"));
+}
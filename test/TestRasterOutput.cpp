@@ -0,0 +1,184 @@
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "RasterOutput.h"
+
+namespace
+{
+    // an 8x2 dot black block at (8, 4), in points
+    PageDisplayList makeBlockPage()
+    {
+        const uint8_t rows[] = { 0xff, 0xff };
+
+        PageDisplayList page;
+        page.addBitmap(8.0, 4.0, 1.0, 1.0, 8, 2, rows, 1);
+        return page;
+    }
+
+    bool isInBlock(int x, int y)
+    {
+        return x >= 8 && x < 16 && y >= 4 && y < 6;
+    }
+
+    std::vector<uint8_t> readFile(const std::filesystem::path &path)
+    {
+        std::ifstream f(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+    uint32_t get16(const std::vector<uint8_t> &data, size_t offset)
+    {
+        return data.at(offset) | data.at(offset + 1) << 8;
+    }
+
+    uint32_t get32(const std::vector<uint8_t> &data, size_t offset)
+    {
+        return get16(data, offset) | get16(data, offset + 2) << 16;
+    }
+
+    uint32_t getBigEndian32(const std::vector<uint8_t> &data, size_t offset)
+    {
+        return data.at(offset) << 24 | data.at(offset + 1) << 16 | data.at(offset + 2) << 8 | data.at(offset + 3);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RasterOutput_lookupFormat)
+{
+    BOOST_TEST((RasterOutput::lookupFormat("png") == RasterFormat::Png));
+    BOOST_TEST((RasterOutput::lookupFormat("tiff") == RasterFormat::Tiff));
+    BOOST_TEST(RasterOutput::getExtension(RasterFormat::Pbm) == ".pbm");
+    BOOST_CHECK_THROW(RasterOutput::lookupFormat("gif"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(RasterOutput_emptyPbm)
+{
+    // one by a half inch at 20 dpi
+    const RasterOutput output({ RasterFormat::Pbm, 20.0, false }, PageSize(72.0, 36.0));
+    const std::vector<uint8_t> pbm = output.encodePage(PageDisplayList(), output.createFontCache());
+
+    const std::string header = "P4\n20 10\n";
+    BOOST_REQUIRE(pbm.size() == header.size() + 3 * 10);
+    BOOST_TEST(std::string(pbm.begin(), pbm.begin() + header.size()) == header);
+    for (size_t i = header.size(); i < pbm.size(); i++)
+        BOOST_TEST(pbm[i] == 0);
+}
+
+BOOST_AUTO_TEST_CASE(RasterOutput_pbm)
+{
+    // at 72 dpi, a point is a pixel
+    const RasterOutput output({ RasterFormat::Pbm, 72.0, false }, PageSize(32.0, 16.0));
+    const std::vector<uint8_t> pbm = output.encodePage(makeBlockPage(), output.createFontCache());
+
+    const std::string header = "P4\n32 16\n";
+    BOOST_REQUIRE(pbm.size() == header.size() + 4 * 16);
+    BOOST_TEST(std::string(pbm.begin(), pbm.begin() + header.size()) == header);
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 32; x++)
+        {
+            const bool black = pbm[header.size() + y * 4 + x / 8] & (0x80 >> (x % 8));
+            BOOST_TEST(black == isInBlock(x, y), "pixel " << x << ", " << y);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RasterOutput_grayPng)
+{
+    const RasterOutput output({ RasterFormat::Png, 72.0, false }, PageSize(32.0, 16.0));
+    const std::vector<uint8_t> png = output.encodePage(makeBlockPage(), output.createFontCache());
+
+    const std::vector<uint8_t> signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    BOOST_REQUIRE(png.size() > 33);
+    BOOST_TEST(std::vector<uint8_t>(png.begin(), png.begin() + 8) == signature, boost::test_tools::per_element());
+
+    // IHDR: 32x16, 8-bit grayscale
+    BOOST_TEST(std::string(png.begin() + 12, png.begin() + 16) == "IHDR");
+    BOOST_TEST(getBigEndian32(png, 16) == 32u);
+    BOOST_TEST(getBigEndian32(png, 20) == 16u);
+    BOOST_TEST(png[24] == 8);
+    BOOST_TEST(png[25] == 0);
+
+    // then a single IDAT with rows of a filter byte and the pixels
+    const uint32_t idatSize = getBigEndian32(png, 33);
+    BOOST_REQUIRE(std::string(png.begin() + 37, png.begin() + 41) == "IDAT");
+
+    std::vector<uint8_t> pixels(16 * 33);
+    uLongf size = pixels.size();
+    BOOST_REQUIRE(uncompress(pixels.data(), &size, png.data() + 41, idatSize) == Z_OK);
+    BOOST_REQUIRE(size == pixels.size());
+
+    for (int y = 0; y < 16; y++)
+    {
+        BOOST_TEST(pixels[y * 33] == 0);
+        for (int x = 0; x < 32; x++)
+            BOOST_TEST(pixels[y * 33 + 1 + x] == (isInBlock(x, y) ? 0 : 255), "pixel " << x << ", " << y);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RasterOutput_twoPageTiff)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "dotprint-RasterOutput.tiff";
+
+    RasterOutput output({ RasterFormat::Tiff, 72.0, false }, PageSize(32.0, 16.0));
+    const std::vector<uint8_t> emptyStrip = output.encodePage(PageDisplayList(), output.createFontCache());
+    const std::vector<uint8_t> blockStrip = output.encodePage(makeBlockPage(), output.createFontCache());
+    BOOST_TEST(emptyStrip != blockStrip);
+
+    output.open(path.string());
+    output.writePage(emptyStrip);
+    output.writePage(blockStrip);
+    output.close();
+
+    const std::vector<uint8_t> tiff = readFile(path);
+    std::filesystem::remove(path);
+
+    // little endian header
+    BOOST_REQUIRE(tiff.size() > 8);
+    BOOST_TEST(std::string(tiff.begin(), tiff.begin() + 4) == std::string("II\x2a\0", 4));
+
+    const std::vector<uint8_t> *strips[] = { &emptyStrip, &blockStrip };
+    uint32_t ifdOffset = get32(tiff, 4);
+    unsigned page = 0;
+    for (; ifdOffset != 0 && page < 3; page++)
+    {
+        BOOST_TEST(ifdOffset % 2 == 0u);
+
+        // the value (or offset) of each tag; short values are in the low half
+        std::map<uint16_t, uint32_t> tags;
+        const uint32_t entryCount = get16(tiff, ifdOffset);
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            const size_t entry = ifdOffset + 2 + 12 * i;
+            const uint32_t value = get32(tiff, entry + 8);
+            tags[get16(tiff, entry)] = get16(tiff, entry + 2) == 3 && get32(tiff, entry + 4) == 1 ? value & 0xffff : value;
+        }
+
+        BOOST_TEST(tags[256] == 32u);
+        BOOST_TEST(tags[257] == 16u);
+        BOOST_TEST(tags[258] == 1u);
+        BOOST_TEST(tags[259] == 4u);
+        BOOST_TEST((tags[297] & 0xffff) == page);
+
+        BOOST_TEST(get32(tiff, tags[282]) == 7200u);
+        BOOST_TEST(get32(tiff, tags[282] + 4) == 100u);
+
+        if (page < 2)
+        {
+            const std::vector<uint8_t> &strip = *strips[page];
+            BOOST_REQUIRE(tags[279] == strip.size());
+            BOOST_REQUIRE(tags[273] + strip.size() <= tiff.size());
+            BOOST_TEST(std::equal(strip.begin(), strip.end(), tiff.begin() + tags[273]));
+        }
+
+        ifdOffset = get32(tiff, ifdOffset + 2 + 12 * entryCount);
+    }
+
+    BOOST_TEST(page == 2u);
+}
@@ -0,0 +1,115 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <glibmm.h>
+
+#include "CairoTTY.h"
+#include "DisplayList.h"
+#include "FontCache.h"
+#include "PreprocessorFactory.h"
+#include "translators/BuiltinCodepages.h"
+
+/*
+ * Count the allocations of the test binary while countAllocations is set,
+ * so that the test below can check the text path doesn't allocate. Other
+ * tests don't set it and aren't affected.
+ */
+namespace
+{
+    std::atomic<bool> countAllocations(false);
+    std::atomic<size_t> allocationCount(0);
+
+    /** \brief Records the allocation count when each page is finished. */
+    class AllocationSink: public IPageSink
+    {
+    public:
+        AllocationSink()
+        {
+            m_counts.reserve(16);
+            m_textRuns.reserve(16);
+        }
+
+        virtual void addPage(const PageDisplayList &page) override
+        {
+            m_counts.push_back(allocationCount);
+            m_textRuns.push_back(page.getTextRuns().size());
+        }
+
+        std::vector<size_t> m_counts;
+        std::vector<size_t> m_textRuns;
+    };
+}
+
+void *operator new(std::size_t size)
+{
+    if (countAllocations)
+        allocationCount++;
+
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+BOOST_AUTO_TEST_CASE(TextAllocations_steadyState)
+{
+    auto translator = std::make_shared<BuiltinCodepageTranslator>(*BuiltinCodepageFactory::lookup("cp850"));
+
+    // some text, with non-ASCII characters (ö, ß, ü), a page of it per form feed
+    const std::string line = "Invoice 4711: 3x Widget, Gr\x94\xe1" "e 12, M\x81nchen\r\n";
+    std::string pageText;
+    for (unsigned row = 0; row < 40; row++)
+        pageText += line;
+    pageText += '\f';
+
+    std::string input;
+    for (unsigned page = 0; page < 3; page++)
+        input += pageText;
+
+    AllocationSink sink;
+    {
+        CairoTTY ctty(PageSize(595.0, 842.0), Margins(36.0, 36.0, 36.0, 36.0),
+            PreprocessorFactory::lookup("epson")(), translator, std::make_shared<FontCache>(), &sink);
+
+        countAllocations = true;
+        ctty.write(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+        countAllocations = false;
+    }
+
+    BOOST_REQUIRE(sink.m_counts.size() >= 2u);
+    BOOST_TEST(sink.m_textRuns[1] == 40u);
+
+    // the first page sizes the buffers (so the counting works), the second one must not allocate
+    BOOST_TEST(sink.m_counts[0] > 0u);
+    BOOST_TEST(sink.m_counts[1] - sink.m_counts[0] == 0u);
+}